@@ -3,37 +3,537 @@
  *
  * See app/comm_protocol.h. Pure logic on top of drivers/rs485, so it is
  * fully testable without the physical RS485 link.
+ *
+ * Register and report state lives in FRAM (#pragma PERSISTENT). Every
+ * reset still starts from comm_protocol_init(); the point is the LPM3.5
+ * deep sleep, whose wake-up is a reset that skips the init and carries on
+ * with this state as it was (app/state_machine).
  */
 
+#include <stddef.h>
 #include "config.h"
 #include "drivers/rs485.h"
+#include "app/telem_log.h"
 #include "app/comm_protocol.h"
 
-/* The read (holding) registers, indexed by register address 0..8. */
-static uint16_t s_regs[COMM_NUM_READ_REGS];
-
 /* Last valve command received, VALVE_CMD_* (cleared when read). */
 static uint8_t s_valve_cmd = VALVE_CMD_NONE;
 
+/* RS485 rate requested through REG_CFG_BAUD, 0 = none (cleared when
+ * read). */
+static uint32_t s_baud_req;
+
+/* Intact frames for us, fast path included (see comm_protocol_rx_count). */
+#pragma PERSISTENT(s_rx_count)
+static volatile uint16_t s_rx_count = 0;
+
+/* The selectable rates, in REG_CFG_BAUD units. */
+#define BAUD_REG_VALUE(b)   (uint16_t)((b) / 100),
+static const uint16_t s_baud_values[] = { RS485_BAUD_TABLE(BAUD_REG_VALUE) };
+
+/* The read (holding) registers, kept as they go on the wire: register n
+ * is s_img[2n] (high byte) and s_img[2n + 1]. The descriptor table
+ * below points into it, so reads are plain byte copies. Volatile because
+ * the 0x03 fast path reads it from the RS485 gap ISR. */
+#pragma PERSISTENT(s_img)
+static volatile uint8_t s_img[COMM_NUM_READ_REGS * 2] = {0};
+
+/* Running CRC after the header and data of a full-block 0x03 response
+ * (start 0, all registers), valid until the next telemetry update. The
+ * gateway's usual poll then costs a copy and no CRC pass. */
+#pragma PERSISTENT(s_full_read_crc)
+static volatile uint16_t s_full_read_crc = 0;
+#pragma PERSISTENT(s_full_read_crc_ok)
+static volatile uint8_t  s_full_read_crc_ok = 0;
+
+/* Set by the main loop while it changes register storage (s_img, s_cfg)
+ * or the CRC cache. The fast path sees a torn image only if it runs in
+ * that window, so it leaves those frames to the main loop instead. */
+static volatile uint8_t s_img_busy;
+
+/* Telemetry generation: bumped whenever an update changes s_img, so
+ * anything derived from the image can tell whether it is still current. */
+#pragma PERSISTENT(s_img_gen)
+static uint16_t s_img_gen = 0;
+
+/* Register n as a number (for the deadband compare). */
+static uint16_t reg_get(uint8_t n)
+{
+    return (uint16_t)(((uint16_t)s_img[2 * n] << 8) | s_img[2 * n + 1]);
+}
+
+static void reg_set(uint8_t n, uint16_t v)
+{
+    s_img[2 * n]     = (uint8_t)(v >> 8);
+    s_img[2 * n + 1] = (uint8_t)(v & 0xFF);
+}
+
+/* reg_set(), returning 1 if the value changed. */
+static uint8_t reg_update(uint8_t n, uint16_t v)
+{
+    if (reg_get(n) == v)
+        return 0;
+    reg_set(n, v);
+    return 1;
+}
+
+/* Configuration registers (REG_CFG_*), big-endian like s_img. Set to the
+ * config.h defaults by comm_protocol_init(), so a reset returns to the
+ * defaults (an LPM3.5 wake-up keeps them). */
+#pragma PERSISTENT(s_cfg)
+static volatile uint8_t s_cfg[REG_CFG_COUNT * 2] = {0};
+
+static uint16_t cfg_get(uint8_t n)
+{
+    return (uint16_t)(((uint16_t)s_cfg[2 * n] << 8) | s_cfg[2 * n + 1]);
+}
+
+static void cfg_set(uint8_t n, uint16_t v)
+{
+    s_cfg[2 * n]     = (uint8_t)(v >> 8);
+    s_cfg[2 * n + 1] = (uint8_t)(v & 0xFF);
+}
+
+/* Diagnostic registers (REG_DIAG_*), big-endian, counted by the code
+ * they describe. */
+#pragma PERSISTENT(s_diag)
+static volatile uint8_t s_diag[REG_DIAG_COUNT * 2] = {0};
+
+static void diag_set(uint8_t n, uint16_t v)
+{
+    s_img_busy = 1;
+    s_diag[2 * n]     = (uint8_t)(v >> 8);
+    s_diag[2 * n + 1] = (uint8_t)(v & 0xFF);
+    s_img_busy = 0;
+}
+
+static void diag_inc(uint8_t n)
+{
+    diag_set(n, (uint16_t)((((uint16_t)s_diag[2 * n] << 8) |
+                            s_diag[2 * n + 1]) + 1u));
+}
+
+/* Energy profile registers (REG_PROF_*), big-endian, written whole by
+ * comm_protocol_update_profile(). */
+#pragma PERSISTENT(s_prof)
+static volatile uint8_t s_prof[REG_PROF_COUNT * 2] = {0};
+
+/* REG_PROF_RESET written, not yet picked up. */
+static uint8_t s_prof_reset_req;
+
+/* The last full report frame and the telemetry generation it was built
+ * from (s_report_len = 0: none). */
+#pragma PERSISTENT(s_report_frame)
+static uint8_t  s_report_frame[RS485_MAX_FRAME] = {0};
+#pragma PERSISTENT(s_report_len)
+static uint8_t  s_report_len = 0;
+#pragma PERSISTENT(s_report_gen)
+static uint16_t s_report_gen = 0;
+
+/* Write hooks. Called twice per request: with commit = 0 for every
+ * register first (validate only, no side effects), then with commit = 1
+ * once the whole request has passed. Return 0 to reject. */
+static uint8_t write_valve_command(uint16_t value, uint8_t commit)
+{
+    /* value 0 = open, 1 = close */
+    if (commit)
+        s_valve_cmd = (value == 0) ? VALVE_CMD_OPEN : VALVE_CMD_CLOSE;
+    return 1;
+}
+
+static uint8_t write_prof_reset(uint16_t value, uint8_t commit)
+{
+    if (value != 1)
+        return 0;
+    if (commit)
+        s_prof_reset_req = 1;
+    return 1;
+}
+
+static uint8_t write_heartbeat(uint16_t value, uint8_t commit)
+{
+    (void)commit;
+    return value >= MEASURE_INTERVAL_S;   /* shorter than one cycle: no */
+}
+
+static uint8_t write_groups(uint16_t value, uint8_t commit)
+{
+    (void)commit;
+    return value <= 0xFF;                 /* 8 group addresses */
+}
+
+static uint8_t write_baud(uint16_t value, uint8_t commit)
+{
+    uint8_t i;
+    for (i = 0; i < sizeof s_baud_values / sizeof s_baud_values[0]; i++)
+    {
+        if (s_baud_values[i] == value)
+        {
+            if (commit)
+                s_baud_req = (uint32_t)value * 100;
+            return 1;
+        }
+    }
+    return 0;                             /* not a rate we can generate */
+}
+
+/* ----------------------- register descriptors ------------------------
+ * One entry per register (or per multi-word value), SORTED BY ADDRESS,
+ * so any address is found by binary search and a range is then walked
+ * entry by entry. `static const`: the table lives in FRAM.
+ *
+ *   storage : the value's bytes, big-endian as on the wire (NULL for
+ *             registers that only trigger a hook); written by the
+ *             dispatcher when a write is applied
+ *   width   : number of 16-bit registers the value spans (high word
+ *             first). Writes must cover a multi-word value whole.
+ *   access  : REG_ACC_R / REG_ACC_W bits
+ *   write   : optional check / side effect, see the hooks above (only on
+ *             single-word registers)
+ * Register units are those of telemetry_t (x100 for V / A) and config.h.
+ */
+#define REG_ACC_R   0x01
+#define REG_ACC_W   0x02
+
+typedef struct {
+    uint16_t  addr;
+    uint8_t   width;
+    uint8_t   access;
+    volatile uint8_t *storage;
+    uint8_t (*write)(uint16_t value, uint8_t commit);
+} reg_desc_t;
+
+#define REG_TELEM(reg) \
+    { (reg), 1, REG_ACC_R, &s_img[2 * (reg)], NULL }
+#define REG_CFG(reg, hook) \
+    { (reg), 1, REG_ACC_R | REG_ACC_W, \
+      &s_cfg[2 * ((reg) - REG_CFG_BASE)], (hook) }
+#define REG_DIAG(reg) \
+    { (reg), 1, REG_ACC_R, &s_diag[2 * ((reg) - REG_DIAG_BASE)], NULL }
+#define REG_PROF(reg) \
+    { (reg), 2, REG_ACC_R, &s_prof[2 * ((reg) - REG_PROF_BASE)], NULL }
+
+static const reg_desc_t s_reg_table[] = {
+    REG_TELEM(REG_FLOW),
+    REG_TELEM(REG_BATT_VOLTAGE),
+    REG_TELEM(REG_BATT_CURRENT),
+    REG_TELEM(REG_PANEL_VOLTAGE),
+    REG_TELEM(REG_PANEL_CURRENT),
+    REG_TELEM(REG_MOTOR_CURRENT),
+    REG_TELEM(REG_MOTOR_SPEED),
+    REG_TELEM(REG_VALVE_POSITION),
+    REG_TELEM(REG_LT8490_STATUS),
+    { REG_VALVE_COMMAND, 1, REG_ACC_W, NULL, write_valve_command },
+    REG_CFG(REG_CFG_HEARTBEAT_S,                  write_heartbeat),
+    REG_CFG(REG_CFG_DEADBAND(REG_FLOW),           NULL),
+    REG_CFG(REG_CFG_DEADBAND(REG_BATT_VOLTAGE),   NULL),
+    REG_CFG(REG_CFG_DEADBAND(REG_BATT_CURRENT),   NULL),
+    REG_CFG(REG_CFG_DEADBAND(REG_PANEL_VOLTAGE),  NULL),
+    REG_CFG(REG_CFG_DEADBAND(REG_PANEL_CURRENT),  NULL),
+    REG_CFG(REG_CFG_DEADBAND(REG_MOTOR_CURRENT),  NULL),
+    REG_CFG(REG_CFG_DEADBAND(REG_MOTOR_SPEED),    NULL),
+    REG_CFG(REG_CFG_DEADBAND(REG_VALVE_POSITION), NULL),
+    REG_CFG(REG_CFG_DEADBAND(REG_LT8490_STATUS),  NULL),
+    REG_CFG(REG_CFG_GROUPS,                       write_groups),
+    REG_CFG(REG_CFG_BAUD,                         write_baud),
+    REG_DIAG(REG_DIAG_REPORT_HITS),
+    REG_DIAG(REG_DIAG_REPORT_MISSES),
+    REG_DIAG(REG_DIAG_DEEP_RESUMES),
+    REG_DIAG(REG_DIAG_RESUME_ACLK),
+    REG_PROF(REG_PROF_CYCLES),
+    REG_PROF(REG_PROF_CHARGE_UC),
+    REG_PROF(REG_PROF_CHARGE_NC_CYCLE),
+    REG_PROF(REG_PROF_TIME_MS(0)),
+    REG_PROF(REG_PROF_TIME_MS(1)),
+    REG_PROF(REG_PROF_TIME_MS(2)),
+    REG_PROF(REG_PROF_TIME_MS(3)),
+    REG_PROF(REG_PROF_TIME_MS(4)),
+    REG_PROF(REG_PROF_TIME_MS(5)),
+    REG_PROF(REG_PROF_TIME_MS(6)),
+    REG_PROF(REG_PROF_TIME_MS(7)),
+    REG_PROF(REG_PROF_TIME_MS(8)),
+    REG_PROF(REG_PROF_TIME_MS(PROFILE_LPM3)),
+    REG_PROF(REG_PROF_TIME_MS(PROFILE_LPM35)),
+    { REG_PROF_RESET, 1, REG_ACC_W, NULL, write_prof_reset },
+};
+
+#if PROFILE_NUM_BUCKETS != 11
+#error "PROFILE_NUM_BUCKETS changed: update the REG_PROF_TIME_MS entries"
+#endif
+
+#define REG_TABLE_LEN   (sizeof s_reg_table / sizeof s_reg_table[0])
+#define REG_TABLE_END   (&s_reg_table[REG_TABLE_LEN])
+
+/* Find the descriptor covering `addr`; *word = its word offset inside a
+ * multi-word value. NULL (and *word = 0) if no register lives there. */
+static const reg_desc_t *reg_find(uint16_t addr, uint8_t *word)
+{
+    uint8_t lo = 0;
+    uint8_t hi = (uint8_t)REG_TABLE_LEN;
+
+    while (lo < hi)
+    {
+        uint8_t mid = (uint8_t)((lo + hi) / 2u);
+        const reg_desc_t *d = &s_reg_table[mid];
+
+        if (addr < d->addr)
+            hi = mid;
+        else if (addr >= d->addr + d->width)
+            lo = (uint8_t)(mid + 1);
+        else
+        {
+            *word = (uint8_t)(addr - d->addr);
+            return d;
+        }
+    }
+    *word = 0;
+    return NULL;
+}
+
+/* Range walker: one binary search for the first address, then the sorted
+ * table is followed in step with the addresses. d == NULL = hole. */
+typedef struct {
+    const reg_desc_t *d;
+    uint8_t           word;
+    uint16_t          addr;
+} reg_iter_t;
+
+static void reg_iter_start(reg_iter_t *it, uint16_t addr)
+{
+    it->addr = addr;
+    it->d    = reg_find(addr, &it->word);
+}
+
+static void reg_iter_next(reg_iter_t *it)
+{
+    it->addr++;
+    if (it->d == NULL)
+    {
+        it->d = reg_find(it->addr, &it->word);
+        return;
+    }
+    if (++it->word >= it->d->width)
+    {
+        it->word = 0;
+        it->d++;
+        if (it->d == REG_TABLE_END || it->d->addr != it->addr)
+            it->d = NULL;
+    }
+}
+
+/* Can `count` registers from `start` all be read? */
+static uint8_t reg_range_readable(uint16_t start, uint16_t count)
+{
+    reg_iter_t it;
+    uint16_t   i;
+
+    reg_iter_start(&it, start);
+    for (i = 0; i < count; i++, reg_iter_next(&it))
+    {
+        if (it.d == NULL || !(it.d->access & REG_ACC_R))
+            return 0;   /* hole or write-only register in the range */
+    }
+    return 1;
+}
+
+/* Copy `count` readable registers from `start` to p (big-endian). */
+static void reg_range_copy(uint16_t start, uint16_t count, uint8_t *p)
+{
+    reg_iter_t it;
+    uint16_t   i;
+
+    reg_iter_start(&it, start);
+    for (i = 0; i < count; i++, reg_iter_next(&it))
+    {
+        *p++ = it.d->storage[2 * it.word];
+        *p++ = it.d->storage[2 * it.word + 1];
+    }
+}
+
+/*
+ * Write `count` registers from `start`, values big-endian at `v`, all or
+ * nothing: every register is checked (exists, writable, multi-word values
+ * covered whole, hook accepts the value) before any is changed, so a bad
+ * register anywhere in the request leaves the device untouched. Returns 1
+ * if the write was applied.
+ */
+static uint8_t reg_range_write(uint16_t start, uint16_t count,
+                               const uint8_t *v)
+{
+    reg_iter_t it;
+    uint16_t   i;
+
+    /* Phase 1: validate. */
+    reg_iter_start(&it, start);
+    if (it.d != NULL && it.word != 0)
+        return 0;   /* starts in the middle of a multi-word value */
+    for (i = 0; i < count; i++, reg_iter_next(&it))
+    {
+        if (it.d == NULL || !(it.d->access & REG_ACC_W))
+            return 0;
+        if (it.d->write &&
+            !it.d->write((uint16_t)((v[2 * i] << 8) | v[2 * i + 1]), 0))
+            return 0;
+    }
+    if (it.d != NULL && it.word != 0)
+        return 0;   /* ends in the middle of a multi-word value */
+
+    /* Phase 2: apply. Nothing below can fail. */
+    s_img_busy = 1;
+    reg_iter_start(&it, start);
+    for (i = 0; i < count; i++, reg_iter_next(&it))
+    {
+        if (it.d->storage)
+        {
+            it.d->storage[2 * it.word]     = v[2 * i];
+            it.d->storage[2 * it.word + 1] = v[2 * i + 1];
+        }
+    }
+    reg_iter_start(&it, start);
+    for (i = 0; i < count; i++, reg_iter_next(&it))
+    {
+        if (it.d->write)
+            it.d->write((uint16_t)((v[2 * i] << 8) | v[2 * i + 1]), 1);
+    }
+
+    s_full_read_crc_ok = 0;
+    s_img_busy = 0;
+    return 1;
+}
+
+/* Report by exception: the value each register had when last reported
+ * and the number of report cycles since anything was sent. Deadbands and
+ * heartbeat are configuration registers. The heartbeat is counted in
+ * cycles (one build_report() call each), so it needs no timer of its
+ * own. */
+#pragma PERSISTENT(s_reported)
+static uint16_t s_reported[COMM_NUM_READ_REGS] = {0};
+#pragma PERSISTENT(s_silent_cycles)
+static uint16_t s_silent_cycles = 0;
+
 void comm_protocol_init(void)
 {
     uint8_t i;
-    for (i = 0; i < COMM_NUM_READ_REGS; i++)
-        s_regs[i] = 0;
+    for (i = 0; i < COMM_NUM_READ_REGS * 2; i++)
+        s_img[i] = 0;
+    for (i = 0; i < REG_DIAG_COUNT * 2; i++)
+        s_diag[i] = 0;
+    for (i = 0; i < REG_PROF_COUNT * 2; i++)
+        s_prof[i] = 0;
+    s_prof_reset_req = 0;
+    s_img_gen    = 0;
+    s_report_len = 0;
+    s_full_read_crc_ok = 0;
+    s_img_busy = 0;
     s_valve_cmd = VALVE_CMD_NONE;
+    s_rx_count = 0;
+
+    cfg_set(REG_CFG_HEARTBEAT_S - REG_CFG_BASE, REPORT_HEARTBEAT_S);
+    cfg_set(REG_CFG_DEADBAND(REG_FLOW)           - REG_CFG_BASE, REPORT_DB_FLOW);
+    cfg_set(REG_CFG_DEADBAND(REG_BATT_VOLTAGE)   - REG_CFG_BASE, REPORT_DB_BATT_V);
+    cfg_set(REG_CFG_DEADBAND(REG_BATT_CURRENT)   - REG_CFG_BASE, REPORT_DB_BATT_I);
+    cfg_set(REG_CFG_DEADBAND(REG_PANEL_VOLTAGE)  - REG_CFG_BASE, REPORT_DB_PANEL_V);
+    cfg_set(REG_CFG_DEADBAND(REG_PANEL_CURRENT)  - REG_CFG_BASE, REPORT_DB_PANEL_I);
+    cfg_set(REG_CFG_DEADBAND(REG_MOTOR_CURRENT)  - REG_CFG_BASE, REPORT_DB_MOTOR_I);
+    cfg_set(REG_CFG_DEADBAND(REG_MOTOR_SPEED)    - REG_CFG_BASE, REPORT_DB_MOTOR_SPEED);
+    cfg_set(REG_CFG_DEADBAND(REG_VALVE_POSITION) - REG_CFG_BASE, REPORT_DB_VALVE_POS);
+    cfg_set(REG_CFG_DEADBAND(REG_LT8490_STATUS)  - REG_CFG_BASE, REPORT_DB_LT8490);
+    cfg_set(REG_CFG_GROUPS - REG_CFG_BASE, RS485_GROUP_MASK);
+    cfg_set(REG_CFG_BAUD - REG_CFG_BASE, (uint16_t)(RS485_BAUD / 100));
+    s_baud_req = 0;
+
+    /* First report after reset is a full one. */
+    s_silent_cycles = 0xFFFF;
 }
 
 void comm_protocol_update_telemetry(const telemetry_t *t)
 {
-    s_regs[REG_FLOW]           = t->flow;
-    s_regs[REG_BATT_VOLTAGE]   = t->batt_voltage;
-    s_regs[REG_BATT_CURRENT]   = t->batt_current;
-    s_regs[REG_PANEL_VOLTAGE]  = t->panel_voltage;
-    s_regs[REG_PANEL_CURRENT]  = t->panel_current;
-    s_regs[REG_MOTOR_CURRENT]  = t->motor_current;
-    s_regs[REG_MOTOR_SPEED]    = t->motor_speed;
-    s_regs[REG_VALVE_POSITION] = t->valve_position;
-    s_regs[REG_LT8490_STATUS]  = t->lt8490_status;
+    uint8_t changed = 0;
+
+    s_img_busy = 1;
+    changed |= reg_update(REG_FLOW,           t->flow);
+    changed |= reg_update(REG_BATT_VOLTAGE,   t->batt_voltage);
+    changed |= reg_update(REG_BATT_CURRENT,   t->batt_current);
+    changed |= reg_update(REG_PANEL_VOLTAGE,  t->panel_voltage);
+    changed |= reg_update(REG_PANEL_CURRENT,  t->panel_current);
+    changed |= reg_update(REG_MOTOR_CURRENT,  t->motor_current);
+    changed |= reg_update(REG_MOTOR_SPEED,    t->motor_speed);
+    changed |= reg_update(REG_VALVE_POSITION, t->valve_position);
+    changed |= reg_update(REG_LT8490_STATUS,  t->lt8490_status);
+
+    /* Quiet cycles (no flow, no sun) change nothing: the cached report
+     * frame and the full-read CRC then stay valid. */
+    if (changed)
+    {
+        s_img_gen++;
+        s_full_read_crc_ok = 0;
+        /* The cached report is of an older image now. Drop it rather
+         * than rely on the generation: that repeats after 65536 changes
+         * without a full report in between. */
+        s_report_len = 0;
+    }
+    s_img_busy = 0;
+}
+
+uint32_t comm_protocol_get_baud_request(void)
+{
+    uint32_t baud = s_baud_req;
+    s_baud_req = 0;
+    return baud;
+}
+
+uint32_t comm_protocol_get_baud(void)
+{
+    return (uint32_t)cfg_get(REG_CFG_BAUD - REG_CFG_BASE) * 100UL;
+}
+
+void comm_protocol_set_baud(uint32_t baud)
+{
+    s_img_busy = 1;
+    cfg_set(REG_CFG_BAUD - REG_CFG_BASE, (uint16_t)(baud / 100));
+    s_img_busy = 0;
+}
+
+uint16_t comm_protocol_rx_count(void)
+{
+    return s_rx_count;
+}
+
+void comm_protocol_note_resume(uint16_t resume_aclk)
+{
+    diag_inc(REG_DIAG_DEEP_RESUMES - REG_DIAG_BASE);
+    if (resume_aclk != 0)
+        diag_set(REG_DIAG_RESUME_ACLK - REG_DIAG_BASE, resume_aclk);
+}
+
+/* Store v big-endian at s_prof[2 * n] (registers n, n + 1). */
+static void prof_set(uint8_t n, uint32_t v)
+{
+    s_prof[2 * n]     = (uint8_t)(v >> 24);
+    s_prof[2 * n + 1] = (uint8_t)(v >> 16);
+    s_prof[2 * n + 2] = (uint8_t)(v >> 8);
+    s_prof[2 * n + 3] = (uint8_t)(v & 0xFF);
+}
+
+void comm_protocol_update_profile(const profile_report_t *r)
+{
+    uint8_t i;
+
+    s_img_busy = 1;
+    prof_set(REG_PROF_CYCLES - REG_PROF_BASE,          r->cycles);
+    prof_set(REG_PROF_CHARGE_UC - REG_PROF_BASE,       r->charge_uc);
+    prof_set(REG_PROF_CHARGE_NC_CYCLE - REG_PROF_BASE, r->charge_per_cycle_nc);
+    for (i = 0; i < PROFILE_NUM_BUCKETS; i++)
+        prof_set((uint8_t)(REG_PROF_TIME_MS(i) - REG_PROF_BASE),
+                 r->time_ms[i]);
+    s_img_busy = 0;
+}
+
+uint8_t comm_protocol_get_profile_reset(void)
+{
+    uint8_t req = s_prof_reset_req;
+    s_prof_reset_req = 0;
+    return req;
 }
 
 uint8_t comm_protocol_get_valve_command(void)
@@ -45,17 +545,121 @@ uint8_t comm_protocol_get_valve_command(void)
 
 uint8_t comm_protocol_build_report(uint8_t *out)
 {
-    /* All read registers, big-endian, as the frame data field. */
-    uint8_t data[COMM_NUM_READ_REGS * 2];
-    uint8_t i;
+    /* Data field: [bitmap_hi][bitmap_lo] then, for each set bit from
+     * register 0 up, that register big-endian. The bitmap goes first on
+     * the wire, so pick the registers before writing anything. */
+    rs485_frame_t f;
+    uint16_t bitmap = 0;
+    uint16_t heartbeat_cycles;
+    uint8_t  full;
+    uint8_t  i;
+
+    /* In 32 bits: with a 16-bit int a heartbeat near 65535 s would wrap
+     * to 0 cycles here and make every report a full one. */
+    heartbeat_cycles = (uint16_t)(((uint32_t)cfg_get(REG_CFG_HEARTBEAT_S -
+                                                     REG_CFG_BASE)
+                                   + MEASURE_INTERVAL_S - 1)
+                                  / MEASURE_INTERVAL_S);
+    if (s_silent_cycles != 0xFFFF)
+        s_silent_cycles++;
+    full = (s_silent_cycles >= heartbeat_cycles);
+
+    for (i = 0; i < COMM_NUM_READ_REGS; i++)
+    {
+        uint16_t v    = reg_get(i);
+        uint16_t db   = cfg_get(REG_CFG_DEADBAND(i) - REG_CFG_BASE);
+        uint16_t diff = (v > s_reported[i]) ? (uint16_t)(v - s_reported[i])
+                                            : (uint16_t)(s_reported[i] - v);
+
+        if (full || (diff != 0 && diff >= db))
+            bitmap |= (uint16_t)(1u << i);
+    }
+
+    if (bitmap == 0)
+        return 0;   /* nothing crossed its deadband: stay off the air */
+
+    s_silent_cycles = 0;
+
+    /* A full report of an unchanged image is the frame sent last time
+     * (and s_reported already holds its values). */
+    if (full && s_report_len != 0 && s_report_gen == s_img_gen)
+    {
+        for (i = 0; i < s_report_len; i++)
+            out[i] = s_report_frame[i];
+        diag_inc(REG_DIAG_REPORT_HITS - REG_DIAG_BASE);
+        return s_report_len;
+    }
+
+    rs485_frame_begin(&f, out, RS485_DEVICE_ADDRESS, MODBUS_FUNC_REPORT);
+    rs485_frame_put_u16(&f, bitmap);
     for (i = 0; i < COMM_NUM_READ_REGS; i++)
     {
-        data[i * 2]     = (uint8_t)(s_regs[i] >> 8);
-        data[i * 2 + 1] = (uint8_t)(s_regs[i] & 0xFF);
+        if (bitmap & (1u << i))
+        {
+            s_reported[i] = reg_get(i);
+            rs485_frame_put_u8(&f, s_img[2 * i]);
+            rs485_frame_put_u8(&f, s_img[2 * i + 1]);
+        }
     }
 
-    return rs485_build_frame(out, RS485_DEVICE_ADDRESS, MODBUS_FUNC_REPORT,
-                             data, (uint8_t)(COMM_NUM_READ_REGS * 2));
+    if (!full)
+        return rs485_frame_end(&f);
+
+    s_report_len = rs485_frame_end(&f);
+    for (i = 0; i < s_report_len; i++)
+        s_report_frame[i] = out[i];
+    s_report_gen = s_img_gen;
+    diag_inc(REG_DIAG_REPORT_MISSES - REG_DIAG_BASE);
+    return s_report_len;
+}
+
+uint8_t comm_protocol_build_aggregate(uint8_t *out, const telem_agg_t *a)
+{
+    rs485_frame_t f;
+    uint8_t i;
+
+    rs485_frame_begin(&f, out, RS485_DEVICE_ADDRESS, MODBUS_FUNC_REPORT_AGG);
+    rs485_frame_put_u16(&f, a->count);
+    for (i = 0; i < TELEM_NUM_FIELDS; i++)
+    {
+        rs485_frame_put_u16(&f, a->min[i]);
+        rs485_frame_put_u16(&f, a->max[i]);
+        rs485_frame_put_u16(&f, telem_agg_mean(a, i));
+    }
+    return rs485_frame_end(&f);
+}
+
+/* Largest register count whose values fit a response next to
+ * addr + func + byte count + CRC. */
+#define READ_MAX_REGS   ((RS485_MAX_FRAME - 5) / 2)
+
+/* Append [byte_count][registers...] for a validated read range, copied
+ * in place from the big-endian storage. The full-block telemetry poll
+ * reuses its cached CRC. */
+static void put_read_data(rs485_frame_t *f, uint16_t start, uint16_t count)
+{
+    uint8_t nbytes = (uint8_t)(count * 2);
+
+    rs485_frame_put_u8(f, nbytes);
+    reg_range_copy(start, count, rs485_frame_tail(f));
+
+    if (start == 0 && count == COMM_NUM_READ_REGS)
+    {
+        if (!s_full_read_crc_ok)
+        {
+            rs485_frame_commit(f, nbytes);
+            s_full_read_crc    = f->crc;
+            s_full_read_crc_ok = 1;
+        }
+        else
+        {
+            rs485_frame_commit_crc(f, nbytes, s_full_read_crc);
+        }
+    }
+    else
+    {
+        rs485_frame_commit(f, nbytes);
+    }
 }
 
 /* Handle function 0x03 (read holding registers). Returns response length. */
@@ -63,63 +667,127 @@ static uint8_t handle_read(const uint8_t *req, uint8_t *resp)
 {
     uint16_t start = ((uint16_t)req[2] << 8) | req[3];
     uint16_t count = ((uint16_t)req[4] << 8) | req[5];
+    rs485_frame_t f;
 
-    /* Range check against the read-register block. */
-    if (count == 0 || (start + count) > COMM_NUM_READ_REGS)
+    if (count == 0 || count > READ_MAX_REGS ||
+        !reg_range_readable(start, count))
         return 0;
 
-    /* Build the response data: [byte_count][reg_hi reg_lo]... */
-    uint8_t data[1 + COMM_NUM_READ_REGS * 2];
-    data[0] = (uint8_t)(count * 2);
-
-    uint16_t i;
-    for (i = 0; i < count; i++)
-    {
-        uint16_t v = s_regs[start + i];
-        data[1 + i * 2]     = (uint8_t)(v >> 8);    /* Modbus: hi byte first */
-        data[1 + i * 2 + 1] = (uint8_t)(v & 0xFF);
-    }
-
-    return rs485_build_frame(resp, RS485_DEVICE_ADDRESS, MODBUS_FUNC_READ_HOLDING,
-                             data, (uint8_t)(1 + count * 2));
+    rs485_frame_begin(&f, resp, RS485_DEVICE_ADDRESS, MODBUS_FUNC_READ_HOLDING);
+    put_read_data(&f, start, count);
+    return rs485_frame_end(&f);
 }
 
 /* Handle function 0x06 (write single register). Returns response length. */
 static uint8_t handle_write(const uint8_t *req, uint8_t *resp)
 {
-    uint16_t reg   = ((uint16_t)req[2] << 8) | req[3];
-    uint16_t value = ((uint16_t)req[4] << 8) | req[5];
+    uint16_t reg = ((uint16_t)req[2] << 8) | req[3];
 
-    if (reg == REG_VALVE_COMMAND)
-    {
-        /* value 0 = open, 1 = close */
-        s_valve_cmd = (value == 0) ? VALVE_CMD_OPEN : VALVE_CMD_CLOSE;
-    }
-    else
-    {
-        return 0;   /* unknown write register */
-    }
+    /* 0x06 writes exactly one 16-bit register. */
+    if (!reg_range_write(reg, 1, &req[4]))
+        return 0;
 
     /* Modbus write-single-register echoes the request's data field back. */
     return rs485_build_frame(resp, RS485_DEVICE_ADDRESS, MODBUS_FUNC_WRITE_SINGLE,
                              &req[2], 4);
 }
 
-uint8_t comm_protocol_process(const uint8_t *req, uint8_t req_len,
-                              uint8_t *resp)
+/* Handle function 0x10 (write multiple registers). The caller has checked
+ * that req_len matches the byte count. Returns response length. */
+static uint8_t handle_write_multiple(const uint8_t *req, uint8_t *resp)
 {
-    /* Must at least hold address + function + CRC. */
-    if (req_len < 4)
-        return 0;
+    uint16_t start = ((uint16_t)req[2] << 8) | req[3];
+    uint16_t count = ((uint16_t)req[4] << 8) | req[5];
 
-    /* Is it addressed to us? */
-    if (req[0] != RS485_DEVICE_ADDRESS)
+    if (count == 0 || req[6] != count * 2)
+        return 0;
+    if (!reg_range_write(start, count, &req[7]))
         return 0;
 
-    /* Is it intact? */
-    if (!rs485_check_frame(req, req_len))
+    /* Response echoes start address and quantity. */
+    return rs485_build_frame(resp, RS485_DEVICE_ADDRESS,
+                             MODBUS_FUNC_WRITE_MULTIPLE, &req[2], 4);
+}
+
+/* Handle function 0x17 (read/write multiple registers). The write is
+ * applied first, then the read range is returned (Modbus order). Both
+ * ranges are checked before anything is written. */
+static uint8_t handle_read_write_multiple(const uint8_t *req, uint8_t *resp)
+{
+    uint16_t rd_start = ((uint16_t)req[2] << 8) | req[3];
+    uint16_t rd_count = ((uint16_t)req[4] << 8) | req[5];
+    uint16_t wr_start = ((uint16_t)req[6] << 8) | req[7];
+    uint16_t wr_count = ((uint16_t)req[8] << 8) | req[9];
+    rs485_frame_t f;
+
+    if (rd_count == 0 || rd_count > READ_MAX_REGS ||
+        wr_count == 0 || req[10] != wr_count * 2)
+        return 0;
+    if (!reg_range_readable(rd_start, rd_count))
+        return 0;
+    if (!reg_range_write(wr_start, wr_count, &req[11]))
         return 0;
 
+    rs485_frame_begin(&f, resp, RS485_DEVICE_ADDRESS,
+                      MODBUS_FUNC_READ_WRITE_MULTIPLE);
+    put_read_data(&f, rd_start, rd_count);
+    return rs485_frame_end(&f);
+}
+
+/* Handle function 0x42 (read telemetry history). Returns response length. */
+#define LOG_RESP_HDR      (1 + 4 + 4)   /* n, first_seq, newest_seq */
+#define LOG_MAX_PER_FRAME \
+    ((RS485_MAX_FRAME - 4 - LOG_RESP_HDR) / TELEM_LOG_WIRE_SIZE)
+
+static uint8_t handle_read_log(const uint8_t *req, uint8_t *resp)
+{
+    uint32_t seq = ((uint32_t)req[2] << 24) | ((uint32_t)req[3] << 16) |
+                   ((uint32_t)req[4] << 8)  |  (uint32_t)req[5];
+    uint8_t  max = req[6];
+    uint32_t first;
+    uint8_t  n;
+    rs485_frame_t f;
+
+    if (max > LOG_MAX_PER_FRAME)
+        max = LOG_MAX_PER_FRAME;
+
+    /* The records are serialized straight into the response, behind the
+     * header space; the header (which needs n) is filled in after, and
+     * the whole block is CRC'd once by the commit. */
+    rs485_frame_begin(&f, resp, RS485_DEVICE_ADDRESS, MODBUS_FUNC_READ_LOG);
+    uint8_t *p = rs485_frame_tail(&f);
+
+    n = telem_log_read(seq, max, &p[LOG_RESP_HDR], &first);
+    p[0] = n;
+    p[1] = (uint8_t)(first >> 24);
+    p[2] = (uint8_t)(first >> 16);
+    p[3] = (uint8_t)(first >> 8);
+    p[4] = (uint8_t)(first & 0xFF);
+    seq  = telem_log_newest_seq();
+    p[5] = (uint8_t)(seq >> 24);
+    p[6] = (uint8_t)(seq >> 16);
+    p[7] = (uint8_t)(seq >> 8);
+    p[8] = (uint8_t)(seq & 0xFF);
+
+    rs485_frame_commit(&f, (uint8_t)(LOG_RESP_HDR + n * TELEM_LOG_WIRE_SIZE));
+    return rs485_frame_end(&f);
+}
+
+/* Broadcast, or a group address this device is a member of? */
+static uint8_t is_multicast_member(uint8_t addr)
+{
+    if (addr == RS485_BROADCAST_ADDR)
+        return 1;
+    if (addr >= RS485_GROUP_ADDR_FIRST)
+        return (cfg_get(REG_CFG_GROUPS - REG_CFG_BASE) >>
+                (addr - RS485_GROUP_ADDR_FIRST)) & 1u;
+    return 0;
+}
+
+/* Dispatch an addressed, CRC-checked frame by function code. */
+static uint8_t process_function(const uint8_t *req, uint8_t req_len,
+                                uint8_t *resp)
+{
     switch (req[1])   /* function code */
     {
         case MODBUS_FUNC_READ_HOLDING:
@@ -132,7 +800,75 @@ uint8_t comm_protocol_process(const uint8_t *req, uint8_t req_len,
                 return 0;
             return handle_write(req, resp);
 
+        case MODBUS_FUNC_WRITE_MULTIPLE:
+            /* addr+func+start(2)+count(2)+bytes(1)+values+CRC(2) */
+            if (req_len < 9 || req_len != 9 + req[6])
+                return 0;
+            return handle_write_multiple(req, resp);
+
+        case MODBUS_FUNC_READ_WRITE_MULTIPLE:
+            /* addr+func+rd(4)+wr(4)+bytes(1)+values+CRC(2) */
+            if (req_len < 13 || req_len != 13 + req[10])
+                return 0;
+            return handle_read_write_multiple(req, resp);
+
+        case MODBUS_FUNC_READ_LOG:
+            if (req_len != 9)   /* addr+func+seq(4)+count(1)+CRC(2) */
+                return 0;
+            return handle_read_log(req, resp);
+
         default:
             return 0;           /* unsupported function */
     }
 }
+
+uint8_t comm_protocol_process(const uint8_t *req, uint8_t req_len,
+                              uint8_t *resp)
+{
+    /* Must at least hold address + function + CRC. */
+    if (req_len < 4)
+        return 0;
+
+    /* Is it addressed to us: our own address, broadcast, or a group we
+     * belong to? */
+    uint8_t unicast = (req[0] == RS485_DEVICE_ADDRESS);
+    if (!unicast && !is_multicast_member(req[0]))
+        return 0;
+
+    /* Is it intact? */
+    if (!rs485_check_frame(req, req_len))
+        return 0;
+    s_rx_count++;
+
+    /* Broadcast / group: writes only, applied but never answered (the
+     * handlers still build their reply into the scratch `resp`). */
+    if (!unicast)
+    {
+        if (req[1] != MODBUS_FUNC_WRITE_SINGLE &&
+            req[1] != MODBUS_FUNC_WRITE_MULTIPLE)
+            return 0;
+        (void)process_function(req, req_len, resp);
+        return 0;
+    }
+
+    return process_function(req, req_len, resp);
+}
+
+uint8_t comm_protocol_fast_read(const uint8_t *req, uint8_t req_len,
+                                uint8_t *resp)
+{
+    /* A unicast 0x03 only; everything else (and any frame arriving while
+     * the main loop is mid-update) goes the slow way. */
+    if (s_img_busy || req_len != 8 ||
+        req[0] != RS485_DEVICE_ADDRESS || req[1] != MODBUS_FUNC_READ_HOLDING)
+        return 0;
+    if (!rs485_check_frame(req, req_len))
+        return 0;
+
+    /* A bad range returns 0 here too and is dropped by the main loop,
+     * which counts it then: count only the frames answered here. */
+    uint8_t n = handle_read(req, resp);
+    if (n)
+        s_rx_count++;
+    return n;
+}
@@ -4,9 +4,24 @@
  * Sits on top of drivers/rs485 (framing + CRC). Interprets a validated
  * request frame as a modbus-like register access:
  *   function 0x03 = read holding registers (telemetry)
- *   function 0x06 = write single register  (valve command)
+ *   function 0x06 = write single register  (valve command, configuration)
+ *   function 0x10 = write multiple registers
+ *   function 0x17 = read/write multiple registers (write first, then read)
+ * Writes are all-or-nothing: every register of a request is validated
+ * before any of them changes, so one frame reconfigures the device or
+ * leaves it as it was.
+ *   function 0x42 = read telemetry history (app/telem_log), by sequence:
+ *     request  [addr][0x42][seq(4)][count(1)][CRC]
+ *     response [addr][0x42][n][first_seq(4)][newest_seq(4)]
+ *              [n x TELEM_LOG_WIRE_SIZE][CRC]
+ *     n is capped to what fits in RS485_MAX_FRAME; first_seq > seq means
+ *     the older records were already overwritten.
  * and builds the response frame.
  *
+ * Registers are dispatched through a sorted, FRAM-resident descriptor
+ * table in comm_protocol.c (address, storage, width, access, write hook):
+ * a new register is one table line, found by binary search.
+ *
  * Data flow:
  *   state machine --update_telemetry--> [read registers] --0x03--> center
  *   center --0x06 write valve cmd--> [command] --get_valve_command--> motor
@@ -17,11 +32,17 @@
 
 #include <stdint.h>
 #include "telemetry.h"
+#include "app/telem_agg.h"
+#include "app/profile.h"
 
 /* Modbus-like function codes. */
 #define MODBUS_FUNC_READ_HOLDING   0x03   /* read holding registers        */
 #define MODBUS_FUNC_WRITE_SINGLE   0x06   /* write single register         */
+#define MODBUS_FUNC_WRITE_MULTIPLE 0x10   /* write multiple registers      */
+#define MODBUS_FUNC_READ_WRITE_MULTIPLE 0x17  /* read/write multiple       */
 #define MODBUS_FUNC_REPORT         0x41   /* custom: unsolicited telemetry */
+#define MODBUS_FUNC_READ_LOG       0x42   /* custom: telemetry history     */
+#define MODBUS_FUNC_REPORT_AGG     0x43   /* custom: aggregated telemetry  */
 
 /* Read-register (holding register) addresses. */
 #define REG_FLOW            0x0000
@@ -38,6 +59,63 @@
 /* Write-register (command) address. */
 #define REG_VALVE_COMMAND   0x0010   /* value 0 = open, 1 = close */
 
+/* Configuration registers (read/write). They start from the config.h
+ * defaults after every reset (not after an LPM3.5 wake-up):
+ *   REG_CFG_HEARTBEAT_S      report heartbeat, seconds (>= MEASURE_INTERVAL_S)
+ *   REG_CFG_DEADBAND(reg)    report deadband of read register `reg`
+ *   REG_CFG_GROUPS           group membership, bit n = answers writes to
+ *                            address RS485_GROUP_ADDR_FIRST + n
+ *   REG_CFG_BAUD             RS485 rate / 100 (96 = 9600 ... 1152 =
+ *                            115200, RS485_BAUD_TABLE). The write is
+ *                            answered at the old rate, then the link
+ *                            switches; it falls back to RS485_BAUD if no
+ *                            valid frame follows within
+ *                            RS485_BAUD_LINK_TIMEOUT_S.                */
+#define REG_CFG_BASE          0x0020
+#define REG_CFG_HEARTBEAT_S   0x0020
+#define REG_CFG_DEADBAND(reg) (0x0021 + (reg))      /* 0x0021 .. 0x0029 */
+#define REG_CFG_GROUPS        0x002A
+#define REG_CFG_BAUD          0x002B
+#define REG_CFG_COUNT         (3 + COMM_NUM_READ_REGS)
+
+/* Diagnostic registers (read-only, 16-bit, wrap around, zero after
+ * reset):
+ *   REG_DIAG_REPORT_HITS     full reports sent from the cached frame
+ *   REG_DIAG_REPORT_MISSES   full reports that had to be built
+ *   REG_DIAG_DEEP_RESUMES    wake-ups from LPM3.5 (fast resumes)
+ *   REG_DIAG_RESUME_ACLK     last RTC wake from LPM3.5 to main loop,
+ *                            ACLK cycles (30.5 us); 0 = none yet       */
+#define REG_DIAG_BASE           0x0030
+#define REG_DIAG_REPORT_HITS    0x0030
+#define REG_DIAG_REPORT_MISSES  0x0031
+#define REG_DIAG_DEEP_RESUMES   0x0032
+#define REG_DIAG_RESUME_ACLK    0x0033
+#define REG_DIAG_COUNT          4
+
+/* Energy profile (app/profile), read-only 32-bit values, high word first,
+ * refreshed once per measurement cycle; zero after reset or with
+ * PROFILE_ENABLE off:
+ *   REG_PROF_CYCLES          measurement cycles since the profile reset
+ *   REG_PROF_CHARGE_UC       estimated charge drawn since then, uC
+ *   REG_PROF_CHARGE_NC_CYCLE the same per measurement cycle, nC
+ *   REG_PROF_TIME_MS(b)      time in bucket b (state_t value, then
+ *                            PROFILE_LPM3 / PROFILE_LPM35), ms
+ * Writing 1 to REG_PROF_RESET (write-only) restarts the profile.       */
+#define REG_PROF_BASE             0x0040
+#define REG_PROF_CYCLES           0x0040    /* .. 0x0041 */
+#define REG_PROF_CHARGE_UC        0x0042    /* .. 0x0043 */
+#define REG_PROF_CHARGE_NC_CYCLE  0x0044    /* .. 0x0045 */
+#define REG_PROF_TIME_MS(b)       (0x0046 + 2 * (b))  /* .. 0x005B */
+#define REG_PROF_COUNT            (6 + 2 * PROFILE_NUM_BUCKETS)
+#define REG_PROF_RESET            0x005C
+
+/* Broadcast and group addresses. Only write functions (0x06, 0x10) are
+ * accepted on them, and never answered (Modbus: no reply to broadcast),
+ * so one frame actuates a whole bus segment. Groups use the addresses
+ * Modbus reserves above the unicast range 1..247. */
+#define RS485_BROADCAST_ADDR     0x00
+#define RS485_GROUP_ADDR_FIRST   248      /* groups 248 .. 255 */
+
 /* Valve command returned by comm_protocol_get_valve_command(). */
 #define VALVE_CMD_NONE      0
 #define VALVE_CMD_OPEN      1
@@ -50,7 +128,8 @@
 void comm_protocol_init(void);
 
 /* comm_protocol_update_telemetry() — copy fresh telemetry into the read
- * registers, so the next 0x03 request returns current values. */
+ * registers, so the next 0x03 request returns current values. Values equal
+ * to the ones already there leave the cached frames and CRCs valid. */
 void comm_protocol_update_telemetry(const telemetry_t *t);
 
 /*
@@ -58,19 +137,89 @@ void comm_protocol_update_telemetry(const telemetry_t *t);
  * Validates address + CRC, dispatches by function code, and builds the
  * response into `resp` (must hold RS485_MAX_FRAME bytes). Returns the
  * response length, or 0 if the frame is ignored (not our address, bad CRC,
- * or unsupported function/register).
+ * or unsupported function/register) or was a broadcast / group write,
+ * which is applied but never answered. `resp` is used as scratch then.
  */
 uint8_t comm_protocol_process(const uint8_t *req, uint8_t req_len,
                               uint8_t *resp);
 
+/*
+ * comm_protocol_fast_read() — the 0x03 fast path, installed as the RS485
+ * receive hook (uart_rs485_set_rx_hook()) and called from the frame-gap
+ * ISR. Answers a unicast, CRC-valid read holding registers request from
+ * the register image and returns the response length; returns 0 for any
+ * other frame, or while the main loop is changing the registers, leaving
+ * it to comm_protocol_process(). Polls are thus answered within a fixed
+ * time of the end of the request, whatever state the main loop is in.
+ */
+uint8_t comm_protocol_fast_read(const uint8_t *req, uint8_t req_len,
+                                uint8_t *resp);
+
 /*
  * comm_protocol_build_report() — build an unsolicited telemetry frame
- * carrying all read registers (function MODBUS_FUNC_REPORT), for the
- * periodic device->center push. Writes into `out` (>= RS485_MAX_FRAME) and
- * returns the frame length.
+ * (function MODBUS_FUNC_REPORT) for the periodic device->center push, by
+ * exception: only registers that moved by at least their deadband since
+ * they were last reported are included. Call once per measurement cycle;
+ * after REG_CFG_HEARTBEAT_S seconds of silence (and on the first call)
+ * all registers are sent.
+ *
+ * Data field: [bitmap_hi][bitmap_lo][reg...], bit n set = register n
+ * follows, registers in ascending order, each big-endian.
+ *
+ * Writes into `out` (>= RS485_MAX_FRAME) and returns the frame length, or
+ * 0 if there is nothing to report this cycle.
+ *
+ * A full report is kept after it is built, tagged with the telemetry
+ * generation (bumped only when comm_protocol_update_telemetry() changes a
+ * register), and dropped as soon as a register changes. The next full
+ * report with no change in between is copied from it, with no rebuild
+ * and no CRC pass; REG_DIAG_REPORT_HITS / _MISSES count how often that
+ * works.
  */
 uint8_t comm_protocol_build_report(uint8_t *out);
 
+/*
+ * comm_protocol_build_aggregate() — build one aggregated telemetry frame
+ * (function MODBUS_FUNC_REPORT_AGG) from a reporting period's statistics:
+ *   data = [count(2)] then for each register in address order
+ *          [min(2)][max(2)][mean(2)], all big-endian   (56 bytes)
+ * Writes into `out` (>= RS485_MAX_FRAME) and returns the frame length.
+ */
+uint8_t comm_protocol_build_aggregate(uint8_t *out, const telem_agg_t *a);
+
+/*
+ * comm_protocol_get_baud_request() — return the RS485 rate (baud) last
+ * written to REG_CFG_BAUD and clear it, or 0 if none is pending. The
+ * state machine switches the link once the write has been answered.
+ */
+uint32_t comm_protocol_get_baud_request(void);
+
+/* comm_protocol_get_baud() — the rate REG_CFG_BAUD shows, i.e. the one
+ * the link runs at (restored from it after an LPM3.5 wake-up). */
+uint32_t comm_protocol_get_baud(void);
+
+/* comm_protocol_set_baud() — make REG_CFG_BAUD show the rate the link
+ * actually runs at (after a fallback). */
+void comm_protocol_set_baud(uint32_t baud);
+
+/* comm_protocol_rx_count() — free-running count of frames received intact
+ * and addressed to this device, including those answered on the fast
+ * path. A link check compares two readings. */
+uint16_t comm_protocol_rx_count(void);
+
+/* comm_protocol_note_resume() — count a wake-up from LPM3.5 in the
+ * diagnostic registers, with its resume time in ACLK cycles if known
+ * (0 = not an RTC wake, leave REG_DIAG_RESUME_ACLK as it is). */
+void comm_protocol_note_resume(uint16_t resume_aclk);
+
+/* comm_protocol_update_profile() — show a profile report in the REG_PROF_*
+ * registers. */
+void comm_protocol_update_profile(const profile_report_t *r);
+
+/* comm_protocol_get_profile_reset() — non-zero once if REG_PROF_RESET was
+ * written since the last call. */
+uint8_t comm_protocol_get_profile_reset(void);
+
 /*
  * comm_protocol_get_valve_command() — return the last valve command
  * (VALVE_CMD_OPEN / VALVE_CMD_CLOSE) and clear it, or VALVE_CMD_NONE if no
@@ -0,0 +1,108 @@
+/*
+ * app/profile.c — per-state residency and charge estimate implementation.
+ *
+ * See app/profile.h.
+ */
+
+#include "config.h"
+#include "app/profile.h"
+
+/* Board current estimate per bucket, uA, in bucket order. */
+static const uint16_t s_i_ua[PROFILE_NUM_BUCKETS] = {
+    PROFILE_I_UA_INIT,     PROFILE_I_UA_IDLE,    PROFILE_I_UA_MEASURE,
+    PROFILE_I_UA_TRANSMIT, PROFILE_I_UA_CMD,     PROFILE_I_UA_MOTOR,
+    PROFILE_I_UA_FAULT,    PROFILE_I_UA_BUTTON,  PROFILE_I_UA_HMI_RX,
+    PROFILE_I_UA_LPM3,     PROFILE_I_UA_LPM35
+};
+
+void profile_start(profile_t *p, uint8_t bucket, uint32_t now)
+{
+    p->cur = bucket;
+    profile_reset(p, now);
+}
+
+void profile_reset(profile_t *p, uint32_t now)
+{
+    uint8_t i;
+    for (i = 0; i < PROFILE_NUM_BUCKETS; i++)
+    {
+        p->s[i]    = 0;
+        p->aclk[i] = 0;
+    }
+    p->cycles = 0;
+    p->since  = now;
+}
+
+void profile_add(profile_t *p, uint8_t bucket, uint32_t aclk)
+{
+    uint16_t t;
+
+    if (bucket >= PROFILE_NUM_BUCKETS)
+        return;
+
+    /* Whole seconds straight into s[], the rest with carry. */
+    p->s[bucket] += aclk / PROFILE_ACLK_HZ;
+    t = (uint16_t)(p->aclk[bucket] + (aclk % PROFILE_ACLK_HZ));
+    if (t >= PROFILE_ACLK_HZ)
+    {
+        t = (uint16_t)(t - PROFILE_ACLK_HZ);
+        p->s[bucket]++;
+    }
+    p->aclk[bucket] = t;
+}
+
+void profile_switch(profile_t *p, uint8_t bucket, uint32_t now)
+{
+    profile_add(p, p->cur, now - p->since);    /* mod 2^32 */
+    profile_rebase(p, bucket, now);
+}
+
+void profile_rebase(profile_t *p, uint8_t bucket, uint32_t now)
+{
+    p->cur   = bucket;
+    p->since = now;
+}
+
+void profile_cycle(profile_t *p)
+{
+    p->cycles++;
+}
+
+void profile_report(const profile_t *p, profile_report_t *r)
+{
+    uint32_t uc = 0;
+    uint32_t nc = 0;        /* below 1 uC, summed over the buckets */
+    uint8_t  i;
+
+    for (i = 0; i < PROFILE_NUM_BUCKETS; i++)
+    {
+        /* aclk < 2^15 and the current < 2^16: q fits 32 bits. */
+        uint32_t q = (uint32_t)p->aclk[i] * s_i_ua[i];
+
+        r->time_ms[i] = p->s[i] * 1000UL +
+                        (((uint32_t)p->aclk[i] * 1000UL) >> 15);
+        uc += p->s[i] * s_i_ua[i] + (q >> 15);
+        nc += ((q & 0x7FFFUL) * 1000UL) >> 15;
+    }
+    uc += nc / 1000UL;
+    nc %= 1000UL;
+
+    r->cycles    = p->cycles;
+    r->charge_uc = uc;
+    r->charge_per_cycle_nc = 0;
+    if (p->cycles)
+    {
+        uint32_t c   = p->cycles;
+        uint32_t rem = uc % c;
+
+        /* rem x 1000 fits 32 bits for the first 4 million cycles; past
+         * that, a coarser division loses nothing that shows. Over 4.29 C
+         * per cycle saturates. */
+        if (uc / c >= 4294000UL)
+            r->charge_per_cycle_nc = 0xFFFFFFFFUL;
+        else
+            r->charge_per_cycle_nc = (uc / c) * 1000UL +
+                ((rem < 4000000UL) ? (rem * 1000UL + nc) / c
+                                   : rem / (c / 1000UL));
+    }
+}
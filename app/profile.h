@@ -0,0 +1,77 @@
+/*
+ * app/profile.h — per-state residency and charge estimate (app layer).
+ *
+ * Answers "where does the battery go": the state machine marks every
+ * switch between states and low-power modes, with a timestamp from the
+ * free-running ACLK timebase (bsp/timer), and the time in between is
+ * added to the bucket being left. Buckets are the state machine's states
+ * (PROFILE_NUM_STATES, in state_t order) plus the two sleep modes. Each
+ * bucket has a board current estimate (PROFILE_I_UA_* in config.h); time
+ * x current gives the charge, reported per measurement cycle.
+ *
+ * Time is counted in ACLK cycles (30.5 us) and folded into whole seconds,
+ * so no bucket overflows in the field. Interrupts are charged to whatever
+ * bucket is current (mostly LPM3), and an LPM0 wait inside a handler to
+ * that handler's state.
+ *
+ * No hardware access: timestamps come in as arguments, so the state
+ * machine keeps profile_t in FRAM and the totals survive LPM3.5.
+ */
+
+#ifndef APP_PROFILE_H_
+#define APP_PROFILE_H_
+
+#include <stdint.h>
+
+#define PROFILE_NUM_STATES  9   /* state_t values (app/state_machine.c) */
+
+/* Buckets: 0 .. PROFILE_NUM_STATES - 1 = state_t, then the sleep modes. */
+#define PROFILE_LPM3        (PROFILE_NUM_STATES + 0)  /* idle, LPM3        */
+#define PROFILE_LPM35       (PROFILE_NUM_STATES + 1)  /* idle, LPM3.5      */
+#define PROFILE_NUM_BUCKETS (PROFILE_NUM_STATES + 2)
+
+#define PROFILE_ACLK_HZ     32768UL
+
+typedef struct {
+    uint32_t s[PROFILE_NUM_BUCKETS];    /* whole seconds per bucket      */
+    uint16_t aclk[PROFILE_NUM_BUCKETS]; /* + ACLK cycles (< 1 s)         */
+    uint32_t cycles;                    /* measurement cycles counted    */
+    uint32_t since;                     /* timestamp of the last switch  */
+    uint8_t  cur;                       /* bucket being timed            */
+} profile_t;
+
+/* Derived figures, as the diagnostic registers show them. */
+typedef struct {
+    uint32_t cycles;                        /* since the last reset      */
+    uint32_t charge_uc;                     /* total, uC                 */
+    uint32_t charge_per_cycle_nc;           /* nC, 0 before any cycle    */
+    uint32_t time_ms[PROFILE_NUM_BUCKETS];  /* residency (wraps, 49 d)   */
+} profile_report_t;
+
+/* profile_start() — clear everything and start timing `bucket` at `now`
+ * (timebase ACLK cycles). */
+void profile_start(profile_t *p, uint8_t bucket, uint32_t now);
+
+/* profile_reset() — clear the totals; the current bucket goes on from
+ * `now`. */
+void profile_reset(profile_t *p, uint32_t now);
+
+/* profile_switch() — add the time since the last switch to the current
+ * bucket, then time `bucket` from `now`. */
+void profile_switch(profile_t *p, uint8_t bucket, uint32_t now);
+
+/* profile_add() — add `aclk` cycles measured some other way to `bucket`
+ * (the LPM3.5 sleep, during which the timebase is off). */
+void profile_add(profile_t *p, uint8_t bucket, uint32_t aclk);
+
+/* profile_rebase() — time `bucket` from `now` without adding anything,
+ * after the timebase has restarted. */
+void profile_rebase(profile_t *p, uint8_t bucket, uint32_t now);
+
+/* profile_cycle() — count one measurement cycle. */
+void profile_cycle(profile_t *p);
+
+/* profile_report() — residency in ms and the charge estimate. */
+void profile_report(const profile_t *p, profile_report_t *r);
+
+#endif /* APP_PROFILE_H_ */
@@ -3,6 +3,10 @@
  *
  * See app/state_machine.h. Stubs are marked "TODO Phase N" where a
  * not-yet-built module plugs in.
+ *
+ * Context that must outlive an LPM3.5 sleep is #pragma PERSISTENT (FRAM)
+ * here and in the modules it calls; everything else is rebuilt on demand
+ * after the wake-up (do_resume, periph_need).
  */
 
 #include <msp430.h>
@@ -14,11 +18,16 @@
 #include "bsp/uart.h"
 #include "bsp/i2c.h"
 #include "bsp/timer.h"
+#include "bsp/event.h"
 #include "bsp/power.h"
 #include "drivers/sensors.h"
 #include "drivers/mcp4706.h"
 #include "drivers/hmi.h"
+#include "drivers/crc16.h"
 #include "app/comm_protocol.h"
+#include "app/telem_log.h"
+#include "app/telem_agg.h"
+#include "app/profile.h"
 #include "app/state_machine.h"
 
 typedef enum {
@@ -27,145 +36,527 @@ typedef enum {
     ST_MEASURE,
     ST_TRANSMIT,
     ST_CMD_PROCESS,
-    ST_MOTOR_CTRL
+    ST_MOTOR_CTRL,
+    ST_FAULT,
+    ST_BUTTON,
+    ST_HMI_RX
 } state_t;
 
+/* The profile has one bucket per state, in this order. */
+typedef char profile_states_match[
+    (ST_HMI_RX + 1 == PROFILE_NUM_STATES) ? 1 : -1];
+
 /* Debug-view globals (watch in the CCS Expressions view):
- *   g_state          - current state (0=INIT..5=MOTOR_CTRL)
+ *   g_state          - current handler (0=INIT..5=MOTOR_CTRL,
+ *                      6=FAULT, 7=BUTTON, 8=HMI_RX; IDLE = asleep)
  *   g_cycle_count    - number of measure/transmit cycles completed
  *   g_telem          - the telemetry gathered this cycle
- *   g_last_frame_len - length of the last telemetry frame sent
+ *   g_last_frame_len - length of this cycle's telemetry frame (0 = none)
+ *   g_crc16_bench    - CRC16 backend timings (CRC16_BENCH_ENABLE only)
  */
 volatile uint8_t  g_state;
-volatile uint32_t g_cycle_count;
-telemetry_t       g_telem;
+#pragma PERSISTENT(g_cycle_count)
+volatile uint32_t g_cycle_count = 0;
+#pragma PERSISTENT(g_telem)
+telemetry_t       g_telem = {0};
 volatile uint8_t  g_last_frame_len;
+#if CRC16_BENCH_ENABLE
+crc16_bench_t     g_crc16_bench;
+#endif
 
 static uint8_t s_frame[RS485_MAX_FRAME];
 static uint8_t s_pending_cmd = VALVE_CMD_NONE;
 
-/* Convert a real unit (V or A) to the register encoding (x100), clamped to
- * the unsigned 16-bit range. */
-static uint16_t scale_x100(float v)
+/* MOTOR_STALL_I_X100 as a raw ADC code, for the stall watch. */
+static uint16_t s_stall_code;
+
+/* comm_protocol_rx_count() at the last RS485 link check. */
+#pragma PERSISTENT(s_link_rx_count)
+static uint16_t s_link_rx_count = 0;
+
+#if REPORT_AGG_CYCLES
+#pragma PERSISTENT(s_agg)
+static telem_agg_t s_agg = {0};  /* this reporting period's statistics */
+#endif
+
+#if PROFILE_ENABLE
+/* Energy profile (app/profile), and rtc_uptime_ticks() when the last
+ * LPM3.5 attempt began: the timebase is off through that sleep. */
+#pragma PERSISTENT(s_prof)
+static profile_t s_prof = {0};
+#pragma PERSISTENT(s_prof_deep_at)
+static uint32_t  s_prof_deep_at = 0;
+#endif
+
+/* Set just before an LPM3.5 attempt, consumed by the wake-up: the FRAM
+ * context above is then current and do_resume() may replace do_init(). */
+#define CONTEXT_VALID   0xC5A5u
+#pragma PERSISTENT(s_context)
+static uint16_t s_context = 0;
+
+/* Peripherals brought up on demand. do_init() starts them all; after an
+ * LPM3.5 wake-up each is started the first time a state needs it. */
+#define PERIPH_ADC      0x01    /* ADC12_B + reference   */
+#define PERIPH_I2C      0x02    /* eUSCI_B0 (DAC)        */
+#define PERIPH_HMI      0x04    /* eUSCI_A2 (screen)     */
+#define PERIPH_ALL      (PERIPH_ADC | PERIPH_I2C | PERIPH_HMI)
+
+static uint8_t s_periph_up;
+
+/* Start whatever of `need` is not running yet. */
+static void periph_need(uint8_t need)
+{
+    uint8_t missing = (uint8_t)(need & ~s_periph_up);
+
+    if (missing & PERIPH_ADC)
+        adc_init();
+    if (missing & PERIPH_I2C)
+        i2c_init();
+    if (missing & PERIPH_HMI)
+        uart_hmi_init();
+    s_periph_up |= missing;
+}
+
+/* Profile hooks; all no-ops with PROFILE_ENABLE off. */
+
+/* Time `bucket` (a state_t or PROFILE_LPM3 / _LPM35) from now on. */
+static void prof_mark(uint8_t bucket)
+{
+#if PROFILE_ENABLE
+    profile_switch(&s_prof, bucket, timebase_now());
+    if (bucket == PROFILE_LPM35)
+        s_prof_deep_at = rtc_uptime_ticks();
+#else
+    (void)bucket;
+#endif
+}
+
+/* Show the profile in the REG_PROF_* registers. */
+static void prof_publish(void)
+{
+#if PROFILE_ENABLE
+    profile_report_t r;
+    profile_report(&s_prof, &r);
+    comm_protocol_update_profile(&r);
+#endif
+}
+
+/* Start profiling from scratch, in INIT (real reset). */
+static void prof_start(void)
+{
+#if PROFILE_ENABLE
+    timebase_init();
+    profile_start(&s_prof, ST_INIT, timebase_now());
+#endif
+}
+
+/* One measurement cycle done: count it and show the new figures. */
+static void prof_cycle(void)
+{
+#if PROFILE_ENABLE
+    profile_cycle(&s_prof);
+#endif
+    prof_publish();
+}
+
+/* REG_PROF_RESET: clear the totals and show that at once. */
+static void prof_reset(void)
 {
-    if (v < 0.0f)
-        v = 0.0f;
-    float s = v * 100.0f;
-    if (s > 65535.0f)
-        s = 65535.0f;
-    return (uint16_t)s;
+#if PROFILE_ENABLE
+    profile_reset(&s_prof, timebase_now());
+#endif
+    prof_publish();
 }
 
-/* INIT — bring up every peripheral, then go idle. */
-static state_t do_init(void)
+/* After an LPM3.5 wake-up: the sleep, as the RTC saw it, goes to
+ * PROFILE_LPM35 except for the part `resume_aclk` says was the resume
+ * so far, which goes to ST_INIT with the rest of do_resume(). */
+static void prof_resume(uint16_t resume_aclk)
+{
+#if PROFILE_ENABLE
+    uint32_t slept = (rtc_uptime_ticks() - s_prof_deep_at) *
+                     (PROFILE_ACLK_HZ / RTC_TICKS_PER_S);
+
+    timebase_init();
+    if (resume_aclk > slept)
+        resume_aclk = (uint16_t)slept;
+    profile_add(&s_prof, PROFILE_LPM35, slept - resume_aclk);
+    profile_add(&s_prof, ST_INIT, resume_aclk);
+    profile_rebase(&s_prof, ST_INIT, timebase_now());
+#else
+    (void)resume_aclk;
+#endif
+}
+
+/* Until both crystals run the clocks, check them every CLOCK_XT_POLL_MS
+ * (do_clock_check). This first poll only arms the settle check: it can
+ * switch nothing over, the crystals having just been turned on. */
+static void clock_poll_start(void)
+{
+    if (clock_poll() != CLOCK_ALL)
+        rtc_schedule(RTC_DL_CLOCK, RTC_MS(CLOCK_XT_POLL_MS),
+                     RTC_MS(CLOCK_XT_POLL_MS));
+}
+
+/* INIT — bring up every peripheral. */
+static void do_init(void)
 {
     clock_init();          /* Phase 1  */
+    prof_start();          /* profile everything from here on    */
     gpio_init();           /* Phase 2  */
     adc_init();            /* Phase 4  */
+    s_stall_code = sensor_x100_to_raw(SENSOR_MOTOR_I, MOTOR_STALL_I_X100);
     i2c_init();            /* Phase 6  */
     uart_rs485_init();     /* Phase 3  */
     uart_hmi_init();       /* Phase 12 */
     comm_protocol_init();  /* Phase 9  */
+    uart_rs485_set_rx_hook(comm_protocol_fast_read);  /* 0x03 from the ISR */
+    telem_log_init();      /* Phase 9: recover the FRAM history  */
+#if REPORT_AGG_CYCLES
+    telem_agg_reset(&s_agg);
+#endif
     mcp4706_init();        /* Phase 6: DAC config (VREF=VDD)     */
     hmi_init();            /* Phase 12: startup backlight level  */
     rtc_init();            /* Phase 5: start the periodic wake   */
+#if CRC16_BENCH_ENABLE
+    crc16_bench(&g_crc16_bench);
+#endif
+
+    clock_poll_start();    /* Phase 1: crystals settle from here */
+
+    /* FRAM-kept context starts afresh on a real reset. */
+    g_cycle_count   = 0;
+    s_link_rx_count = 0;
 
     /* TODO Phase 7: motor_init();  Phase 8: lt8490_init();
      * TODO Phase 11: uss_init();                                     */
 
-    return ST_IDLE;
+    s_periph_up = PERIPH_ALL;
 }
 
-/* IDLE — sleep until the RTC signals a measurement is due.
- * Race-free check-then-sleep (see Phase 5). RS485-RX and FAULT wake sources
- * will branch here too once wired. */
-static state_t do_idle(void)
+/* INIT after an LPM3.5 wake-up — the fast path. Everything kept in FRAM
+ * (register map, report state, RTC schedule, history, this file's
+ * context) is taken as it is; only what listens for the next wake-up is
+ * started here, the rest by periph_need() when a state wants it. The
+ * DAC and the screen kept their own settings, so mcp4706_init() and
+ * hmi_init() are not repeated either. */
+static void do_resume(void)
 {
-    for (;;)
-    {
-        __disable_interrupt();
-        if (rtc_measurement_due())
-        {
-            __enable_interrupt();
-            break;
-        }
-        power_enter_sleep();   /* LPM (LPM1 with UART on); wakes on interrupt */
-    }
-    rtc_clear_measurement_due();
-    return ST_MEASURE;
+    uint16_t resume_aclk;
+
+    /* The pins are still latched from before the sleep: set them up
+     * again before clock_resume() releases them, so nothing glitches. */
+    gpio_init();
+    uart_rs485_init();
+    clock_resume();
+
+    if (comm_protocol_get_baud() != RS485_BAUD)
+        uart_rs485_set_baud(comm_protocol_get_baud());
+    uart_rs485_set_rx_hook(comm_protocol_fast_read);
+    s_stall_code = sensor_x100_to_raw(SENSOR_MOTOR_I, MOTOR_STALL_I_X100);
+
+    resume_aclk = rtc_resume();
+    comm_protocol_note_resume(resume_aclk);
+    prof_resume(resume_aclk);
+    clock_poll_start();
+}
+
+/* Whether an idle wait may go down to LPM3.5: nothing running that needs
+ * a clock or RAM (the RS485 link listening, no motor watch) and no RTC
+ * deadline soon enough to make the resume cost more than it saves. The
+ * crystal poll is such a deadline, so ACLK is on LFXT, as the calendar
+ * alarm that times the sleep needs, before this can hold. */
+static uint8_t deep_sleep_ok(void)
+{
+#if POWER_DEEP_SLEEP_MIN_S
+    return uart_rs485_listening() && !adc_stall_watch_active() &&
+           rtc_ticks_to_next() >= RTC_SECONDS(POWER_DEEP_SLEEP_MIN_S);
+#else
+    return 0;
+#endif
 }
 
 /* MEASURE — gather this cycle's telemetry. */
-static state_t do_measure(void)
+static void do_measure(void)
 {
     /* TODO Phase 11: enable ±15V, wait ~10 ms, USS measure -> flow. */
     g_telem.flow = 0;
 
-    g_telem.batt_voltage  = scale_x100(sensor_battery_voltage());
-    g_telem.batt_current  = scale_x100(sensor_battery_current());
-    g_telem.panel_voltage = scale_x100(sensor_panel_voltage());
-    g_telem.panel_current = scale_x100(sensor_panel_current());
-    g_telem.motor_current = scale_x100(sensor_motor_current());
+    /* All five analog values from one ADC sequence, already in the x100
+     * register encoding. */
+    sensor_read_all(&g_telem);
 
     g_telem.motor_speed    = 0;   /* TODO Phase 7: current speed %      */
     g_telem.valve_position = 0;   /* TODO Phase 7: real valve position  */
     g_telem.lt8490_status  = 0;   /* TODO Phase 8: charger status        */
 
-    return ST_TRANSMIT;
+    /* Every cycle goes into the FRAM history, reported or not. */
+    telem_log_append(&g_telem, rtc_uptime_s());
 }
 
 /* TRANSMIT — push the telemetry frame to the center. */
-static state_t do_transmit(void)
+static void do_transmit(void)
 {
     comm_protocol_update_telemetry(&g_telem);
 
     /* Telemetry goes to two sinks: the center over RS485, and the local
-     * HMI screen over its own UART. */
+     * HMI screen over its own UART. The RS485 report is either one
+     * aggregate per period or by exception, so it is often empty (0) this
+     * cycle; the screen always gets fresh values. */
+#if REPORT_AGG_CYCLES
+    telem_agg_add(&s_agg, &g_telem);
+    g_last_frame_len = 0;
+    if (s_agg.count >= REPORT_AGG_CYCLES)
+    {
+        g_last_frame_len = comm_protocol_build_aggregate(s_frame, &s_agg);
+        telem_agg_reset(&s_agg);
+    }
+#else
     g_last_frame_len = comm_protocol_build_report(s_frame);
-    uart_rs485_send(s_frame, g_last_frame_len);
+#endif
+    if (g_last_frame_len)
+        uart_rs485_send_async(s_frame, g_last_frame_len);  /* DMA, returns now */
     hmi_update(&g_telem);   /* stub until the widget command table arrives */
 
     g_cycle_count++;
+    prof_cycle();
     GPIO_toggleOutputOnPin(LED1_PORT, LED1_PIN);   /* sign of life */
 
-    /* If a command arrived (RS485 RX, wired later), handle it next. */
+    /* s_frame is reused for replies: sleep in LPM0 until the DMA and the
+     * shift register are done with it. */
+    uart_rs485_wait_tx();
+}
+
+/* CMD_PROCESS — answer every queued RS485 request and pick up a pending
+ * valve command for MOTOR_CTRL. */
+static void do_cmd_process(void)
+{
+    uint8_t req[RS485_MAX_FRAME];
+    uint8_t n;
+
+    while ((n = uart_rs485_read_frame(req)) != 0)
+    {
+        /* comm_protocol_process() checks address + CRC; 0 = no reply. */
+        uint8_t resp_len = comm_protocol_process(req, n, s_frame);
+        if (resp_len)
+            uart_rs485_send(s_frame, resp_len);
+    }
+
+    /* A rate change takes effect only now, after its reply went out at
+     * the old rate. Away from RS485_BAUD the link is checked every
+     * RS485_BAUD_LINK_TIMEOUT_S (see do_link_check). */
+    uint32_t baud = comm_protocol_get_baud_request();
+    if (baud != 0 && uart_rs485_set_baud(baud))
+    {
+        s_link_rx_count = comm_protocol_rx_count();
+        if (baud != RS485_BAUD)
+            rtc_schedule(RTC_DL_RS485_LINK,
+                         RTC_SECONDS(RS485_BAUD_LINK_TIMEOUT_S),
+                         RTC_SECONDS(RS485_BAUD_LINK_TIMEOUT_S));
+        else
+            rtc_cancel(RTC_DL_RS485_LINK);
+    }
+
+    if (comm_protocol_get_profile_reset())
+        prof_reset();
+
     s_pending_cmd = comm_protocol_get_valve_command();
-    return (s_pending_cmd != VALVE_CMD_NONE) ? ST_CMD_PROCESS : ST_IDLE;
 }
 
-/* CMD_PROCESS — a valve command is pending; route it to the motor. */
-static state_t do_cmd_process(void)
+/* Link check at a switched RS485 rate: no intact frame for us in a whole
+ * period means the master cannot reach us at this rate (or is gone), so
+ * go back to RS485_BAUD, where it can always find the device again. */
+static void do_link_check(void)
+{
+    uint16_t count = comm_protocol_rx_count();
+
+    if (count != s_link_rx_count)
+    {
+        s_link_rx_count = count;   /* link alive: stay */
+        return;
+    }
+
+    rtc_cancel(RTC_DL_RS485_LINK);
+    uart_rs485_set_baud(RS485_BAUD);
+    comm_protocol_set_baud(RS485_BAUD);
+}
+
+/* INIT, continued — a crystal poll: the firmware has been running on the
+ * internal oscillators since clock_init(); clock_poll() moves each clock
+ * onto its crystal once that has settled. */
+static void do_clock_check(void)
 {
-    return ST_MOTOR_CTRL;
+    if (clock_poll() == CLOCK_ALL)
+        rtc_cancel(RTC_DL_CLOCK);
 }
 
 /* MOTOR_CTRL — drive the valve. */
-static state_t do_motor_ctrl(void)
+static void do_motor_ctrl(void)
 {
     /* TODO Phase 7: run the motor sub-state machine (brake, direction,
-     * accelerate, run until stall/encoder/timeout, verify). */
+     * accelerate, run until stall/encoder/timeout, verify). Once past the
+     * start-up inrush, adc_stall_watch_start(s_stall_code) hands the
+     * current watch to the hardware and RUNNING just sleeps; a stall
+     * comes back as EVT_MOTOR_STALL (do_motor_stall). */
     g_telem.valve_position =
         (s_pending_cmd == VALVE_CMD_OPEN) ? 1 : 0;   /* stub */
     s_pending_cmd = VALVE_CMD_NONE;
-    return ST_IDLE;
 }
 
+/* MOTOR_CTRL, stall exit — the ADC window comparator saw the motor
+ * current above MOTOR_STALL_I_X100. The watch has already stopped. */
+static void do_motor_stall(void)
+{
+    /* TODO Phase 7: BRAKE_STOP, then VERIFY the stall against the encoder
+     * (end stop reached, or jammed -> FAULT). */
+}
+
+/* FAULT — charger fault reported. */
+static void do_fault(void)
+{
+    /* TODO Phase 8: read the LT8490 status, log it, park the valve if the
+     * battery can no longer carry a full stroke. */
+}
+
+/* BUTTON — a front-panel button was pressed. */
+static void do_button(void)
+{
+    /* TODO Phase 12: read BTN_PORT and drive the local menu. */
+}
+
+/* HMI_RX — the screen sent something: drain it so the ring never fills. */
+static void do_hmi_rx(void)
+{
+    uint8_t buf[16];
+
+    /* TODO Phase 12: feed the bytes to the Giraffe reply/touch parser. */
+    while (uart_hmi_read(buf, sizeof buf) != 0)
+        ;
+}
+
+/* Peripherals each state needs running (see periph_need()). */
+static const uint8_t s_state_periph[] = {
+    [ST_INIT]        = 0,
+    [ST_IDLE]        = 0,
+    [ST_MEASURE]     = PERIPH_ADC,
+    [ST_TRANSMIT]    = PERIPH_HMI,
+    [ST_CMD_PROCESS] = 0,
+    [ST_MOTOR_CTRL]  = PERIPH_ADC | PERIPH_I2C,
+    [ST_FAULT]       = 0,
+    [ST_BUTTON]      = PERIPH_HMI,
+    [ST_HMI_RX]      = PERIPH_HMI,
+};
+
+/* MCLK level each state runs at (see mclk_need()). Compute-bound work is
+ * cheapest at 8 MHz, where FRAM needs no wait states. That includes
+ * MEASURE: with panel-current oversampling the ADC12 ISR adds up five
+ * 32-bit sums and re-triggers the sequence every conversion, so at 1 MHz
+ * it would mostly stretch the measurement window. IDLE is the level left
+ * set for the interrupts while the CPU sleeps. (Phase 11: the flow
+ * computation in MEASURE will want CLOCK_MCLK_16MHZ.) */
+static const uint8_t s_state_mclk[] = {
+    [ST_INIT]        = CLOCK_MCLK_8MHZ,
+    [ST_IDLE]        = CLOCK_MCLK_8MHZ,
+    [ST_MEASURE]     = CLOCK_MCLK_8MHZ,
+    [ST_TRANSMIT]    = CLOCK_MCLK_8MHZ,
+    [ST_CMD_PROCESS] = CLOCK_MCLK_8MHZ,
+    [ST_MOTOR_CTRL]  = CLOCK_MCLK_8MHZ,
+    [ST_FAULT]       = CLOCK_MCLK_8MHZ,
+    [ST_BUTTON]      = CLOCK_MCLK_8MHZ,
+    [ST_HMI_RX]      = CLOCK_MCLK_8MHZ,
+};
+
+/* Set the MCLK level for a state. 1 MHz is too slow for the RS485 RX
+ * interrupt above MCLK_LOW_MAX_BAUD, so at those rates it is 8 MHz. */
+static void mclk_need(uint8_t level)
+{
+    if (level == CLOCK_MCLK_1MHZ &&
+        comm_protocol_get_baud() > MCLK_LOW_MAX_BAUD)
+        level = CLOCK_MCLK_8MHZ;
+    clock_set_mclk(level);
+}
+
+/* Run one handler with its state recorded for the debugger and the
+ * profile, after setting its MCLK level and starting whatever it needs. */
+#define RUN_STATE(st, fn) \
+    do { \
+        g_state = (uint8_t)(st); \
+        prof_mark(st); \
+        mclk_need(s_state_mclk[st]); \
+        periph_need(s_state_periph[st]); \
+        fn(); \
+    } while (0)
+
 void state_machine_run(void)
 {
-    state_t state = ST_INIT;
+    g_state = ST_INIT;
+    if (power_woke_from_deep_sleep() && s_context == CONTEXT_VALID)
+        do_resume();
+    else
+        do_init();
+    s_context = 0;
 
     for (;;)
     {
-        g_state = (uint8_t)state;
-        switch (state)
+        uint8_t ev;
+
+        g_state = ST_IDLE;
+        prof_mark(ST_IDLE);
+        mclk_need(s_state_mclk[ST_IDLE]);
+        if (deep_sleep_ok())
+        {
+            /* Only a returned attempt gets here past the sleep: the
+             * context is live again from then on. */
+            prof_mark(PROFILE_LPM35);
+            s_context = CONTEXT_VALID;
+            ev = event_wait_deep();
+            s_context = 0;
+        }
+        else
+        {
+            prof_mark(PROFILE_LPM3);
+            ev = event_wait();       /* sleeps until an ISR posts */
+        }
+        prof_mark(ST_IDLE);
+
+        /* Highest urgency first. Anything posted while a handler runs is
+         * picked up by the next event_wait() without sleeping. */
+        if (ev & EVT_FAULT)
+            RUN_STATE(ST_FAULT, do_fault);
+
+        if (ev & EVT_MOTOR_STALL)
+            RUN_STATE(ST_MOTOR_CTRL, do_motor_stall);
+
+        if (ev & EVT_RS485_RX)
         {
-            case ST_INIT:        state = do_init();        break;
-            case ST_IDLE:        state = do_idle();        break;
-            case ST_MEASURE:     state = do_measure();     break;
-            case ST_TRANSMIT:    state = do_transmit();    break;
-            case ST_CMD_PROCESS: state = do_cmd_process(); break;
-            case ST_MOTOR_CTRL:  state = do_motor_ctrl();  break;
-            default:             state = ST_IDLE;          break;
+            RUN_STATE(ST_CMD_PROCESS, do_cmd_process);
+            if (s_pending_cmd != VALVE_CMD_NONE)
+                RUN_STATE(ST_MOTOR_CTRL, do_motor_ctrl);
         }
+
+        if ((ev & EVT_RTC) && rtc_is_due(RTC_DL_CLOCK))
+        {
+            rtc_clear_due(RTC_DL_CLOCK);
+            RUN_STATE(ST_INIT, do_clock_check);
+        }
+
+        if ((ev & EVT_RTC) && rtc_is_due(RTC_DL_RS485_LINK))
+        {
+            rtc_clear_due(RTC_DL_RS485_LINK);
+            RUN_STATE(ST_CMD_PROCESS, do_link_check);
+        }
+
+        if ((ev & EVT_RTC) && rtc_measurement_due())
+        {
+            rtc_clear_measurement_due();
+            RUN_STATE(ST_MEASURE,  do_measure);
+            RUN_STATE(ST_TRANSMIT, do_transmit);
+        }
+
+        if (ev & EVT_BUTTON)
+            RUN_STATE(ST_BUTTON, do_button);
+
+        if (ev & EVT_HMI_RX)
+            RUN_STATE(ST_HMI_RX, do_hmi_rx);
     }
 }
@@ -1,15 +1,38 @@
 /*
  * app/state_machine.h — top-level control flow (app layer).
  *
- * Ties the pieces together into the device's main behavior (CLAUDE.md §5):
- *   INIT -> IDLE (sleep) --RTC--> MEASURE -> TRANSMIT -> IDLE
- *                                                  \--cmd--> CMD_PROCESS
- *                                                            -> MOTOR_CTRL
+ * Ties the pieces together into the device's main behavior (CLAUDE.md §5).
+ * The loop is event-driven: it sleeps in event_wait() (bsp/event) and each
+ * ISR that has work posts a wake-source bit. One wake runs every handler
+ * whose bit is set, most urgent first:
+ *
+ *   INIT -> IDLE (sleep) --FAULT-------> FAULT
+ *                        --MOTOR STALL-> MOTOR_CTRL (stall exit)
+ *                        --RS485 RX----> CMD_PROCESS -> MOTOR_CTRL (cmd)
+ *                        --RTC---------> MEASURE -> TRANSMIT
+ *                        --BUTTON------> BUTTON
+ *                        --HMI RX------> HMI_RX
+ *           ... then back to IDLE once no bit is pending.
+ *
+ * A received frame is answered after ISR latency, not at the next
+ * measurement, and the idle loop wakes only for posted work. Plain 0x03
+ * reads do not reach CMD_PROCESS at all: comm_protocol_fast_read()
+ * answers them from the RS485 frame-gap ISR, even mid-MEASURE or
+ * mid-MOTOR_CTRL.
+ *
+ * An idle wait with nothing running and the next RTC deadline at least
+ * POWER_DEEP_SLEEP_MIN_S away goes down to LPM3.5. Its wake-up is a reset
+ * that takes a fast-resume path instead of INIT: the context is in FRAM,
+ * and peripherals are started as the next state needs them.
+ *
+ * With PROFILE_ENABLE, every state and sleep is timed (app/profile) and
+ * the estimated charge per measurement cycle is kept in the REG_PROF_*
+ * registers, so a power change can be checked in the field.
  *
  * Current status: the MEASURE ADC reads, TRANSMIT telemetry frame, sleep/
- * wake, and command dispatch are real. USS flow, motor control, and LT8490
- * status are stubs, filled in by Phases 11 / 7 / 8. RS485 receive (to wake
- * on a command) is added with the physical link.
+ * wake, RS485 receive and command dispatch are real. USS flow, motor
+ * control, LT8490 status/fault, the button menu and HMI replies are stubs,
+ * filled in by Phases 11 / 7 / 8 / 12.
  */
 
 #ifndef APP_STATE_MACHINE_H_
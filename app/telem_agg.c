@@ -0,0 +1,50 @@
+/*
+ * app/telem_agg.c — running min/max/mean implementation.
+ *
+ * See app/telem_agg.h.
+ */
+
+#include "app/telem_agg.h"
+
+void telem_agg_reset(telem_agg_t *a)
+{
+    uint8_t i;
+    a->count = 0;
+    for (i = 0; i < TELEM_NUM_FIELDS; i++)
+    {
+        a->min[i] = 0xFFFF;
+        a->max[i] = 0;
+        a->sum[i] = 0;
+    }
+}
+
+void telem_agg_add(telem_agg_t *a, const telemetry_t *t)
+{
+    /* Field order = register order (telemetry.h / comm_protocol.h). */
+    const uint16_t v[TELEM_NUM_FIELDS] = {
+        t->flow,          t->batt_voltage,  t->batt_current,
+        t->panel_voltage, t->panel_current, t->motor_current,
+        t->motor_speed,   t->valve_position, t->lt8490_status
+    };
+    uint8_t i;
+
+    if (a->count == 0xFFFF)
+        return;
+
+    for (i = 0; i < TELEM_NUM_FIELDS; i++)
+    {
+        if (v[i] < a->min[i])
+            a->min[i] = v[i];
+        if (v[i] > a->max[i])
+            a->max[i] = v[i];
+        a->sum[i] += v[i];
+    }
+    a->count++;
+}
+
+uint16_t telem_agg_mean(const telem_agg_t *a, uint8_t i)
+{
+    if (a->count == 0)
+        return 0;
+    return (uint16_t)((a->sum[i] + a->count / 2u) / a->count);
+}
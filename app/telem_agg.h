@@ -0,0 +1,37 @@
+/*
+ * app/telem_agg.h — running min/max/mean over several cycles (app layer).
+ *
+ * Sits between MEASURE and TRANSMIT: every measurement cycle is added to
+ * the aggregate, and once per reporting period (REPORT_AGG_CYCLES cycles)
+ * the aggregate is sent as one compact frame (MODBUS_FUNC_REPORT_AGG) and
+ * restarted. Sampling rate and radio traffic are then set independently.
+ *
+ * Pure integer logic; the aggregate is a plain struct owned by the caller.
+ */
+
+#ifndef APP_TELEM_AGG_H_
+#define APP_TELEM_AGG_H_
+
+#include <stdint.h>
+#include "telemetry.h"
+
+#define TELEM_NUM_FIELDS    9   /* uint16_t fields in telemetry_t */
+
+/* Per-field statistics, indexed in telemetry_t / register order. */
+typedef struct {
+    uint16_t count;                     /* cycles added so far          */
+    uint16_t min[TELEM_NUM_FIELDS];
+    uint16_t max[TELEM_NUM_FIELDS];
+    uint32_t sum[TELEM_NUM_FIELDS];     /* for the mean; fits 65535 cycles */
+} telem_agg_t;
+
+/* telem_agg_reset() — start a new period (count = 0). */
+void telem_agg_reset(telem_agg_t *a);
+
+/* telem_agg_add() — fold one cycle in. Ignored once count is 65535. */
+void telem_agg_add(telem_agg_t *a, const telemetry_t *t);
+
+/* telem_agg_mean() — rounded mean of field `i`, or 0 if count is 0. */
+uint16_t telem_agg_mean(const telem_agg_t *a, uint8_t i);
+
+#endif /* APP_TELEM_AGG_H_ */
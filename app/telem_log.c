@@ -0,0 +1,180 @@
+/*
+ * app/telem_log.c — power-fail-safe telemetry history implementation.
+ *
+ * See app/telem_log.h. Layout in FRAM:
+ *   s_log[]  - TELEM_LOG_CAPACITY fixed-size records, each with its own
+ *              sequence number and a CRC16 over the record;
+ *   s_head   - index of the slot the next record goes into;
+ *   s_boot   - number of resets seen.
+ *
+ * Power-fail safety: a record is written completely (CRC last) into the
+ * slot at s_head, and only then is s_head advanced by a single 16-bit
+ * store, which the CPU does in one FRAM write. A power loss before that
+ * store leaves the previous log intact; the half-written slot fails its
+ * CRC (or still holds the oldest record) and is overwritten next time.
+ * There is no separate tail: the oldest record is simply the one CAPACITY
+ * sequence numbers back, and readers skip slots whose CRC fails.
+ *
+ * All of this runs in the main loop only, so no interrupt locking.
+ */
+
+#include <stddef.h>
+#include "config.h"
+#include "drivers/crc16.h"
+#include "app/telem_log.h"
+
+typedef struct {
+    uint32_t    seq;        /* 1, 2, 3, ...; 0 = never written           */
+    uint32_t    time_s;     /* seconds since boot `boot`                 */
+    uint16_t    boot;
+    telemetry_t t;
+    uint16_t    crc;        /* CRC16 over everything above               */
+} log_rec_t;
+
+#define REC_CRC_LEN   offsetof(log_rec_t, crc)
+
+/* FRAM-resident: not touched by the C startup, so it survives resets.
+ * (The MPU's read/write segment covers .TI.persistent, see the linker
+ * command file.) */
+#pragma PERSISTENT(s_log)
+static log_rec_t s_log[TELEM_LOG_CAPACITY] = {{0}};
+#pragma PERSISTENT(s_head)
+static uint16_t s_head = 0;
+#pragma PERSISTENT(s_boot)
+static uint16_t s_boot = 0;
+
+/* Recovered from the records by telem_log_init(); kept in FRAM as well
+ * so an LPM3.5 wake-up, which skips the init, carries on from it. */
+#pragma PERSISTENT(s_next_seq)
+static uint32_t s_next_seq = 0;
+
+static uint16_t rec_crc(const log_rec_t *r)
+{
+    return crc16_modbus(0xFFFF, (const uint8_t *)r, REC_CRC_LEN);
+}
+
+static uint8_t rec_valid(const log_rec_t *r)
+{
+    return r->seq != 0 && r->crc == rec_crc(r);
+}
+
+/* Slot index of sequence `seq`, given that `newest` sits at s_head - 1. */
+static uint16_t slot_of(uint32_t seq, uint32_t newest)
+{
+    uint32_t back = newest - seq;     /* caller keeps this < CAPACITY */
+    return (uint16_t)((s_head + TELEM_LOG_CAPACITY - 1u - back)
+                      % TELEM_LOG_CAPACITY);
+}
+
+void telem_log_init(void)
+{
+    const log_rec_t *last;
+    uint16_t i;
+
+    if (s_head >= TELEM_LOG_CAPACITY)
+        s_head = 0;
+    s_boot++;
+
+    /* The newest record is normally the one just before s_head. If that
+     * slot is damaged, fall back to the highest valid sequence anywhere,
+     * so sequence numbers never repeat. */
+    last = &s_log[(s_head + TELEM_LOG_CAPACITY - 1u) % TELEM_LOG_CAPACITY];
+    if (rec_valid(last))
+    {
+        s_next_seq = last->seq + 1;
+        return;
+    }
+
+    s_next_seq = 1;
+    for (i = 0; i < TELEM_LOG_CAPACITY; i++)
+    {
+        if (rec_valid(&s_log[i]) && s_log[i].seq >= s_next_seq)
+        {
+            s_next_seq = s_log[i].seq + 1;
+            s_head = (uint16_t)((i + 1u) % TELEM_LOG_CAPACITY);
+        }
+    }
+}
+
+void telem_log_append(const telemetry_t *t, uint32_t time_s)
+{
+    log_rec_t *r = &s_log[s_head];
+
+    r->seq    = s_next_seq;
+    r->time_s = time_s;
+    r->boot   = s_boot;
+    r->t      = *t;
+    r->crc    = rec_crc(r);
+
+    /* Commit point: one 16-bit FRAM write. */
+    s_head = (uint16_t)((s_head + 1u) % TELEM_LOG_CAPACITY);
+    s_next_seq++;
+}
+
+uint32_t telem_log_newest_seq(void)
+{
+    return s_next_seq - 1;
+}
+
+/* Serialize one record for the wire, big-endian (see TELEM_LOG_WIRE_SIZE). */
+static uint8_t *put_record(uint8_t *p, const log_rec_t *r)
+{
+    const uint16_t v[9] = {
+        r->t.flow,          r->t.batt_voltage,  r->t.batt_current,
+        r->t.panel_voltage, r->t.panel_current, r->t.motor_current,
+        r->t.motor_speed,   r->t.valve_position, r->t.lt8490_status
+    };
+    uint8_t i;
+
+    *p++ = (uint8_t)(r->boot >> 8);
+    *p++ = (uint8_t)(r->boot & 0xFF);
+    *p++ = (uint8_t)(r->time_s >> 24);
+    *p++ = (uint8_t)(r->time_s >> 16);
+    *p++ = (uint8_t)(r->time_s >> 8);
+    *p++ = (uint8_t)(r->time_s & 0xFF);
+    for (i = 0; i < 9; i++)
+    {
+        *p++ = (uint8_t)(v[i] >> 8);
+        *p++ = (uint8_t)(v[i] & 0xFF);
+    }
+    return p;
+}
+
+uint8_t telem_log_read(uint32_t seq, uint8_t max, uint8_t *out,
+                       uint32_t *first_seq)
+{
+    uint32_t newest = s_next_seq - 1;
+    uint32_t oldest;
+    uint8_t  n = 0;
+
+    *first_seq = seq;
+    if (newest == 0 || seq > newest)
+        return 0;
+
+    oldest = (newest >= TELEM_LOG_CAPACITY)
+           ? newest - TELEM_LOG_CAPACITY + 1 : 1;
+    if (seq < oldest)
+        seq = oldest;
+
+    while (n < max && seq <= newest)
+    {
+        const log_rec_t *r = &s_log[slot_of(seq, newest)];
+
+        if (!rec_valid(r) || r->seq != seq)
+        {
+            /* A damaged slot ends a run; before the run has started it
+             * is just skipped (the oldest slot may be a torn write). */
+            if (n)
+                break;
+            seq++;
+            continue;
+        }
+
+        if (n == 0)
+            *first_seq = seq;
+        out = put_record(out, r);
+        n++;
+        seq++;
+    }
+    return n;
+}
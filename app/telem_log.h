@@ -0,0 +1,49 @@
+/*
+ * app/telem_log.h — power-fail-safe telemetry history in FRAM (app layer).
+ *
+ * A circular log of the last TELEM_LOG_CAPACITY measurement cycles, kept
+ * in FRAM (#pragma PERSISTENT) so it survives resets and power loss. The
+ * center uses it to backfill reports it missed (MODBUS_FUNC_READ_LOG).
+ *
+ * Every record carries a sequence number that increases by one per record
+ * and never repeats, so the center can ask for "from seq N on". Records
+ * are timestamped with the boot count and the seconds since that boot
+ * (there is no wall clock on the board; the center maps both to real time).
+ */
+
+#ifndef APP_TELEM_LOG_H_
+#define APP_TELEM_LOG_H_
+
+#include <stdint.h>
+#include "telemetry.h"
+
+/* One record as sent on the wire by telem_log_read(), big-endian:
+ *   [boot(2)][time_s(4)][9 registers x 2]  */
+#define TELEM_LOG_WIRE_SIZE   (2 + 4 + 9 * 2)   /* 24 */
+
+/*
+ * telem_log_init() — recover the log after a reset (finds the newest
+ * record, continues its sequence) and count this boot. Call once at
+ * startup.
+ */
+void telem_log_init(void);
+
+/* telem_log_append() — store one cycle's telemetry, stamped `time_s`
+ * seconds since boot. Overwrites the oldest record when full. */
+void telem_log_append(const telemetry_t *t, uint32_t time_s);
+
+/* telem_log_newest_seq() — sequence number of the newest record, or 0 if
+ * the log is empty (sequence numbers start at 1). */
+uint32_t telem_log_newest_seq(void);
+
+/*
+ * telem_log_read() — copy up to `max` consecutive records, starting at
+ * sequence `seq`, into `out` (TELEM_LOG_WIRE_SIZE bytes each). If `seq`
+ * has already been overwritten, starts at the oldest record still held.
+ * Stores the sequence of the first record copied in *first_seq and
+ * returns the number copied (0 if `seq` is newer than the newest record).
+ */
+uint8_t telem_log_read(uint32_t seq, uint8_t max, uint8_t *out,
+                       uint32_t *first_seq);
+
+#endif /* APP_TELEM_LOG_H_ */
@@ -1,16 +1,67 @@
 /*
- * bsp/adc.c — ADC12_B setup and single-channel reads.
+ * bsp/adc.c — ADC12_B setup, sequence and single-channel reads.
  *
  * See bsp/adc.h. All conversions use the internal 2.5 V reference and the
- * 12-bit resolution. Each read reconfigures memory buffer 0 for the
- * requested channel, triggers one conversion, and returns the raw code.
+ * 12-bit resolution. adc_init() programs memory buffers MEM0..MEM4 once,
+ * one per input (adc_input_t order), with end-of-sequence on MEM4. After
+ * that no read ever touches a memory-control register:
+ *   - a sequence read starts at MEM0 and, with multiple-sample-and-convert
+ *     (MSC) set, converts all five on one trigger. The MEM4 interrupt adds
+ *     the results to per-input 32-bit sums and re-triggers the sequence
+ *     until every input has its 2^n samples, then wakes the CPU from LPM0;
+ *     the sums are decimated to 16-bit codes outside the ISR.
+ *   - a single read converts just one pre-programmed MEMx.
+ *   - the stall watch runs MEM4 in repeat-single-channel mode; MEM4 has
+ *     the window comparator enabled from init, and its HI interrupt is the
+ *     only one enabled while the watch runs.
  */
 
 #include <msp430.h>
 #include "driverlib/MSP430FR5xx_6xx/driverlib.h"
 #include "config.h"
+#include "bsp/event.h"
 #include "bsp/adc.h"
 
+/* Memory buffer of each input: byte offsets for configureMemory /
+ * getResults, and the matching CSTARTADD values for startConversion. */
+static const uint8_t s_mem[ADC_IN_COUNT] = {
+    ADC12_B_MEMORY_0, ADC12_B_MEMORY_1, ADC12_B_MEMORY_2,
+    ADC12_B_MEMORY_3, ADC12_B_MEMORY_4
+};
+static const uint16_t s_start[ADC_IN_COUNT] = {
+    ADC12_B_START_AT_ADC12MEM0, ADC12_B_START_AT_ADC12MEM1,
+    ADC12_B_START_AT_ADC12MEM2, ADC12_B_START_AT_ADC12MEM3,
+    ADC12_B_START_AT_ADC12MEM4
+};
+
+/* ADC input channel of each input (adc_input_t order). */
+static const uint8_t s_channel[ADC_IN_COUNT] = {
+    ADC_PANEL_V_CH, ADC_BATT_V_CH, ADC_PANEL_I_CH,
+    ADC_BATT_I_CH,  ADC_MOTOR_I_CH
+};
+
+#if ADC_OSR_LOG2_PANEL_V > 8 || ADC_OSR_LOG2_BATT_V > 8 || \
+    ADC_OSR_LOG2_PANEL_I > 8 || ADC_OSR_LOG2_BATT_I > 8 || \
+    ADC_OSR_LOG2_MOTOR_I > 8
+#error "ADC_OSR_LOG2_* must be 0..8 (1x .. 256x)"
+#endif
+
+/* log2 of the oversampling ratio of each input (adc_input_t order). */
+static const uint8_t s_osr_log2[ADC_IN_COUNT] = {
+    ADC_OSR_LOG2_PANEL_V, ADC_OSR_LOG2_BATT_V, ADC_OSR_LOG2_PANEL_I,
+    ADC_OSR_LOG2_BATT_I,  ADC_OSR_LOG2_MOTOR_I
+};
+
+/* Sequence read in flight: per-input sums, sequences done and needed
+ * (2^max(n)), and a done flag. */
+static uint32_t         s_acc[ADC_IN_COUNT];
+static uint16_t         s_seq_n;
+static uint16_t         s_seq_total;
+static volatile uint8_t s_seq_busy;
+
+/* Stall watch running (cleared by the ISR when it fires). */
+static volatile uint8_t s_watch_on;
+
 void adc_init(void)
 {
     /* --- Switch the five analog input pins to analog mode -----------
@@ -33,7 +84,8 @@ void adc_init(void)
         ;
     Ref_A_setReferenceVoltage(REF_A_BASE, REF_A_VREF2_5V);
     Ref_A_enableReferenceVoltage(REF_A_BASE);
-    __delay_cycles(400);   /* ~50 µs settle time for the reference */
+    /* ~50 µs settle time for the reference, at the fastest MCLK */
+    __delay_cycles(50UL * (CONFIG_MCLK_MAX_FREQ_HZ / 1000000UL));
 
     /* --- Configure the ADC12_B core --------------------------------
      * Sample trigger = software (SC bit), clock = internal ADC oscillator,
@@ -48,45 +100,214 @@ void adc_init(void)
     ADC12_B_init(ADC12_B_BASE, &initParam);
 
     /* Sample-and-hold time: 16 ADC clocks is plenty for our high-impedance
-     * dividers to charge the sampling capacitor.
+     * dividers to charge the sampling capacitor. MSC lets one SC trigger
+     * run the whole sequence back to back.
      */
     ADC12_B_setupSamplingTimer(ADC12_B_BASE,
                                ADC12_B_CYCLEHOLD_16_CYCLES,
                                ADC12_B_CYCLEHOLD_4_CYCLES,
-                               ADC12_B_MULTIPLESAMPLESDISABLE);
+                               ADC12_B_MULTIPLESAMPLESENABLE);
 
     ADC12_B_setResolution(ADC12_B_BASE, ADC12_B_RESOLUTION_12BIT);
+
+    /* --- Program MEM0..MEM4 once, one per input ---------------------
+     * Referenced to the internal reference (+) and VSS (-). Only the last
+     * one ends the sequence.
+     */
+    uint8_t i;
+    for (i = 0; i < ADC_IN_COUNT; i++)
+    {
+        ADC12_B_configureMemoryParam memParam = {0};
+        memParam.memoryBufferControlIndex = s_mem[i];
+        memParam.inputSourceSelect        = s_channel[i];
+        memParam.refVoltageSourceSelect   = ADC12_B_VREFPOS_INTBUF_VREFNEG_VSS;
+        memParam.endOfSequence            = (i == ADC_IN_COUNT - 1)
+                                            ? ADC12_B_ENDOFSEQUENCE
+                                            : ADC12_B_NOTENDOFSEQUENCE;
+        memParam.windowComparatorSelect   = (i == ADC_IN_MOTOR_I)
+                                            ? ADC12_B_WINDOW_COMPARATOR_ENABLE
+                                            : ADC12_B_WINDOW_COMPARATOR_DISABLE;
+        memParam.differentialModeSelect   = ADC12_B_DIFFERENTIAL_MODE_DISABLE;
+        ADC12_B_configureMemory(ADC12_B_BASE, &memParam);
+    }
+
     ADC12_B_enable(ADC12_B_BASE);
 }
 
-uint16_t adc_read_raw(uint8_t input_channel)
+/* Start MEM4 converting back to back with only the HI interrupt armed.
+ * The comparator flags are stale from any earlier conversion of MEM4. */
+static void watch_run(void)
 {
-    /* Clear ENC before touching the memory-control register: ADC12MCTLx
-     * (the channel selection) can only be written while conversions are
-     * disabled (ENC = 0). Without this, every read after the first keeps
-     * the first channel and returns the wrong pin's value.
-     */
-    ADC12_B_disableConversions(ADC12_B_BASE, ADC12_B_COMPLETECONVERSION);
+    ADC12_B_clearInterrupt(ADC12_B_BASE, 2, ADC12_B_HIIFG);
+    ADC12_B_enableInterrupt(ADC12_B_BASE, 0, 0, ADC12_B_HIIE);
+    ADC12_B_startConversion(ADC12_B_BASE,
+                            s_start[ADC_IN_MOTOR_I],
+                            ADC12_B_REPEATED_SINGLECHANNEL);
+}
+
+/* Stop the repeated conversions at once and disarm the interrupt. The
+ * watch stays logically on (s_watch_on) if a read is only pausing it. */
+static void watch_halt(void)
+{
+    ADC12_B_disableInterrupt(ADC12_B_BASE, 0, 0, ADC12_B_HIIE);
+    ADC12_B_disableConversions(ADC12_B_BASE, ADC12_B_PREEMPTCONVERSION);
+}
+
+void adc_stall_watch_start(uint16_t threshold)
+{
+    if (s_watch_on)
+        watch_halt();
+    while (ADC12_B_isBusy(ADC12_B_BASE))
+        ;
+
+    ADC12_B_setWindowCompAdvanced(ADC12_B_BASE, threshold, 0);
+    s_watch_on = 1;
+    watch_run();
+}
+
+void adc_stall_watch_stop(void)
+{
+    if (!s_watch_on)
+        return;
+    watch_halt();
+    s_watch_on = 0;
+}
+
+uint8_t adc_stall_watch_active(void)
+{
+    return s_watch_on;
+}
 
-    /* Point memory buffer 0 at the requested channel, referenced to the
-     * internal reference (+) and VSS (-).
+void adc_read_sequence(uint16_t code[ADC_IN_COUNT])
+{
+    uint8_t i, max = 0;
+
+    /* The stall watch owns the ADC while it runs: pause it. (If it fires
+     * meanwhile, s_watch_on drops and it is not resumed.) */
+    if (s_watch_on)
+        watch_halt();
+    /* Wait out a single conversion that may still be running. */
+    while (ADC12_B_isBusy(ADC12_B_BASE))
+        ;
+
+    for (i = 0; i < ADC_IN_COUNT; i++)
+    {
+        s_acc[i] = 0;
+        if (s_osr_log2[i] > max)
+            max = s_osr_log2[i];
+    }
+    s_seq_n     = 0;
+    s_seq_total = (uint16_t)(1u << max);
+    s_seq_busy  = 1;
+
+    /* The end-of-sequence buffer's flag is the "all done" interrupt. */
+    ADC12_B_clearInterrupt(ADC12_B_BASE, 0, ADC12_B_IFG4);
+    ADC12_B_enableInterrupt(ADC12_B_BASE, ADC12_B_IE4, 0, 0);
+
+    ADC12_B_startConversion(ADC12_B_BASE,
+                            s_start[ADC_IN_PANEL_V],
+                            ADC12_B_SEQOFCHANNELS);
+
+    /* Sleep in LPM0 until the ISR has the results. Race-free check-then-
+     * sleep; the ADC runs from its own oscillator meanwhile. */
+    for (;;)
+    {
+        __disable_interrupt();
+        if (!s_seq_busy)
+        {
+            __enable_interrupt();
+            break;
+        }
+        __bis_SR_register(LPM0_bits | GIE);
+    }
+
+    /* Decimate: a sum of 2^n 12-bit codes has 12 + n bits; shift it onto
+     * the common 16-bit scale. */
+    for (i = 0; i < ADC_IN_COUNT; i++)
+    {
+        uint8_t n = s_osr_log2[i];
+        code[i] = (n >= 4) ? (uint16_t)(s_acc[i] >> (n - 4))
+                           : (uint16_t)(s_acc[i] << (4 - n));
+    }
+
+    if (s_watch_on)
+        watch_run();
+}
+
+uint16_t adc_read_raw(adc_input_t input)
+{
+    /* The buffer is already pointed at its channel (adc_init), so this is
+     * just one conversion on it. startConversion clears ENC itself before
+     * changing the start address and mode.
      */
-    ADC12_B_configureMemoryParam memParam = {0};
-    memParam.memoryBufferControlIndex = ADC12_B_MEMORY_0;
-    memParam.inputSourceSelect        = input_channel;
-    memParam.refVoltageSourceSelect   = ADC12_B_VREFPOS_INTBUF_VREFNEG_VSS;
-    memParam.endOfSequence            = ADC12_B_ENDOFSEQUENCE;
-    memParam.windowComparatorSelect   = ADC12_B_WINDOW_COMPARATOR_DISABLE;
-    memParam.differentialModeSelect   = ADC12_B_DIFFERENTIAL_MODE_DISABLE;
-    ADC12_B_configureMemory(ADC12_B_BASE, &memParam);
-
-    /* One conversion on memory buffer 0, then wait for the result. */
+    uint16_t result;
+
+    if (s_watch_on)
+        watch_halt();
+    while (ADC12_B_isBusy(ADC12_B_BASE))
+        ;
+
     ADC12_B_startConversion(ADC12_B_BASE,
-                            ADC12_B_MEMORY_0,
+                            s_start[input],
                             ADC12_B_SINGLECHANNEL);
 
     while (ADC12_B_isBusy(ADC12_B_BASE))
         ;
 
-    return ADC12_B_getResults(ADC12_B_BASE, ADC12_B_MEMORY_0);
+    result = ADC12_B_getResults(ADC12_B_BASE, s_mem[input]);
+    if (s_watch_on)
+        watch_run();
+    return result;
+}
+
+/* ADC12_B interrupt — MEM4 (end of sequence) while a sequence read runs,
+ * or the window comparator HI flag while the stall watch runs; never both.
+ * Reading ADC12MEMx clears its flag. Each
+ * input stops accumulating once it has its 2^n samples; the sequence is
+ * re-triggered with ADC12SC (ENC stays set) until the slowest has.
+ */
+#pragma vector = ADC12_B_VECTOR
+__interrupt void adc12_isr(void)
+{
+    switch (__even_in_range(ADC12IV, ADC12IV__ADC12RDYIFG))
+    {
+        case ADC12IV__ADC12HIIFG:                 /* motor current > stall */
+            /* Stop converting at once; the flag cleared itself on the
+             * vector read. */
+            ADC12IER2 &= ~ADC12HIIE;
+            ADC12CTL1 &= ~ADC12CONSEQ_3;
+            ADC12CTL0 &= ~ADC12ENC;
+            s_watch_on = 0;
+            event_post(EVT_MOTOR_STALL);
+            __bic_SR_register_on_exit(LPM3_bits);
+            break;
+
+        case ADC12IV__ADC12IFG4:                  /* sequence complete */
+        {
+            const volatile uint16_t *mem = &ADC12MEM0;  /* MEM0..MEM4 */
+            uint16_t n = s_seq_n;
+            uint8_t  i;
+
+            for (i = 0; i < ADC_IN_COUNT; i++)
+            {
+                uint16_t v = mem[i];
+                if (n < (1u << s_osr_log2[i]))
+                    s_acc[i] += v;
+            }
+
+            s_seq_n = ++n;
+            if (n < s_seq_total)
+            {
+                ADC12CTL0 |= ADC12SC;             /* next sequence */
+                break;
+            }
+
+            ADC12IER0 &= ~ADC12IE4;
+            s_seq_busy = 0;
+            __bic_SR_register_on_exit(LPM3_bits);
+            break;
+        }
+        default:
+            break;
+    }
 }
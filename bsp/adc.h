@@ -1,10 +1,18 @@
 /*
- * bsp/adc.h — ADC12_B setup and single-channel reads (BSP layer).
+ * bsp/adc.h — ADC12_B setup, sequence and single-channel reads (BSP layer).
  *
  * Phase 4 scope: configure the ADC12_B with the internal 2.5 V reference
- * and provide a blocking single-channel read that returns the raw 12-bit
- * code. Conversion to real units (volts, amps) is done one layer up, in
+ * and return raw 12-bit codes. Each of the five analog inputs owns one
+ * memory buffer (MEM0..MEM4, programmed once at init), so reads never
+ * reconfigure the ADC: a sequence read converts all five on one trigger,
+ * a single read converts one. Sequence reads oversample each input by its
+ * own ratio (ADC_OSR_LOG2_*, config.h) and return decimated 16-bit codes.
+ * Conversion to register units is done one layer up, in
  * drivers/sensors.c.
+ *
+ * The motor-current input can also be watched by the hardware: MEM4 then
+ * converts continuously and the window comparator interrupts only on a
+ * stall-level current, so the CPU can sleep for the whole valve travel.
  */
 
 #ifndef BSP_ADC_H_
@@ -12,18 +20,56 @@
 
 #include <stdint.h>
 
+/* Analog inputs, in memory-buffer order (MEM0..MEM4). */
+typedef enum {
+    ADC_IN_PANEL_V,     /* MEM0 */
+    ADC_IN_BATT_V,      /* MEM1 */
+    ADC_IN_PANEL_I,     /* MEM2 */
+    ADC_IN_BATT_I,      /* MEM3 */
+    ADC_IN_MOTOR_I,     /* MEM4, end of sequence */
+    ADC_IN_COUNT
+} adc_input_t;
+
 /*
  * adc_init() — enable the internal 2.5 V reference, configure ADC12_B
- * (12-bit, single conversion), and switch the five analog input pins to
- * analog mode. Call after clock_init().
+ * (12-bit, MEM0..MEM4 = the five inputs), and switch the five analog input
+ * pins to analog mode. Call after clock_init().
  */
 void adc_init(void);
 
 /*
- * adc_read_raw() — perform one conversion on the given ADC input channel
- * (an ADC12_B_INPUT_Ax constant) and return the raw 12-bit result (0..4095).
- * Blocking.
+ * adc_read_sequence() — convert all five inputs, 2^ADC_OSR_LOG2_x times
+ * each, and store the decimated codes in code[], indexed by adc_input_t.
+ * Codes are on a 16-bit scale whatever the ratio: a 12-bit code times 16
+ * at 1x, the full 16 bits at 256x (0 .. 65520 either way). Sleeps in LPM0
+ * between sequences; leaves GIE set.
+ */
+void adc_read_sequence(uint16_t code[ADC_IN_COUNT]);
+
+/*
+ * adc_read_raw() — perform one conversion on a single input and return
+ * the raw 12-bit result (0..4095). Blocking (a few microseconds).
  */
-uint16_t adc_read_raw(uint8_t input_channel);
+uint16_t adc_read_raw(adc_input_t input);
+
+/*
+ * adc_stall_watch_start() — start the hardware stall watch: MEM4 (motor
+ * current) converts in repeat-single-channel mode and the ADC12_B window
+ * comparator interrupts only when a result is above `threshold`, a raw
+ * 12-bit code (see sensor_x100_to_raw()). That interrupt ends the watch
+ * and posts EVT_MOTOR_STALL; nothing wakes the CPU before it. Every
+ * sample is compared, so start the watch only once the motor's start-up
+ * inrush is over. Sequence and single reads still work meanwhile: they
+ * pause the watch and resume it.
+ */
+void adc_stall_watch_start(uint16_t threshold);
+
+/* adc_stall_watch_stop() — end the watch (e.g. target reached). No effect
+ * if it is not running. */
+void adc_stall_watch_stop(void);
+
+/* adc_stall_watch_active() — non-zero while the watch runs (the ADC then
+ * needs the device out of LPM3.5). */
+uint8_t adc_stall_watch_active(void);
 
 #endif /* BSP_ADC_H_ */
@@ -9,24 +9,68 @@
  *      holds all pins in a locked high-impedance state; crystals cannot
  *      start until this lock is cleared.
  *   3. Tell driverlib the crystal frequencies.
- *   4. Start the crystals (blocks until each is stable).
- *   5. Route MCLK/SMCLK to HFXT and ACLK to LFXT.
+ *   4. Run MCLK/SMCLK from the DCO and ACLK from LFMODCLK, and switch the
+ *      crystals on without waiting for them.
+ *   5. Later, from clock_poll(): route ACLK to LFXT and MCLK/SMCLK to
+ *      HFXT, each once its fault flag stays clear.
+ *
+ * A crystal is "settled" when its fault flag, cleared at one poll, is
+ * still clear at the next. s_xt_clear remembers which crystals left the
+ * last poll with the flag clear, so a single clear reading (as at the
+ * first poll, just after the turn-on cleared it) never counts on its
+ * own. driverlib's ...WithTimeout(drive, 1) turn-on is used for both
+ * ends: it switches the crystal on at full start-up drive and only looks
+ * at the flag once, and when that is clear it drops the drive to the
+ * requested setting, as the blocking versions do.
+ *
+ * clock_resume() is the same after an LPM3.5 wake-up, where the LF
+ * crystal is still running and must be kept so across the unlock.
+ *
+ * MCLK levels (clock_set_mclk) only ever move MCLK: SMCLK stays at
+ * CONFIG_SMCLK_FREQ_HZ throughout, so the UART / I2C divisors, computed
+ * for it at build time, never need recomputing. 1 and 8 MHz divide the
+ * 8 MHz source (HFXT, or the DCO before that); 16 MHz runs MCLK from the
+ * DCO, retuned to 16 MHz once HFXT has taken SMCLK over, and needs one
+ * FRAM wait state: raised before MCLK goes up, lowered after it comes
+ * down.
  */
 
 #include <msp430.h>
+#include <stdbool.h>
 #include "driverlib/MSP430FR5xx_6xx/driverlib.h"
 #include "config.h"
 #include "bsp/clock.h"
 
-void clock_init(void)
+/* The UART and I2C divisors are computed for one SMCLK frequency
+ * (bsp/uart_baud.h), so the DCO must stand in for HFXT at the same rate:
+ * the switch then changes the clock's accuracy, not its divisors. */
+#if CONFIG_DCO_FREQ_HZ != CONFIG_SMCLK_FREQ_HZ
+#error "CONFIG_DCO_FREQ_HZ must equal CONFIG_SMCLK_FREQ_HZ"
+#endif
+
+#if CONFIG_MCLK_MAX_FREQ_HZ != 16000000UL
+#error "CONFIG_MCLK_MAX_FREQ_HZ must match the CLOCK_MCLK_16MHZ level"
+#endif
+
+/* Crystals routed to the system clocks so far, CLOCK_LFXT | CLOCK_HFXT. */
+static uint8_t s_xt_used;
+
+/* Crystals whose fault flag was clear (or cleared) at the previous poll,
+ * CLOCK_LFXT | CLOCK_HFXT. Reset by clock_init() / clock_resume(). */
+static uint8_t s_xt_clear;
+
+/* Requested MCLK level, CLOCK_MCLK_*. */
+static uint8_t s_mclk;
+
+/* Crystal pins on Port J:
+ *   LFXIN / LFXOUT = PJ.4 / PJ.5   (32.768 kHz crystal)
+ *   HFXIN / HFXOUT = PJ.6 / PJ.7   (8 MHz crystal)
+ *
+ * Selecting the "primary module function" on these pins connects them
+ * to the oscillator instead of using them as plain GPIO.
+ */
+static void clock_pins(void)
 {
-    /* --- 1. Configure the crystal pins on Port J ---------------------
-     * LFXIN / LFXOUT = PJ.4 / PJ.5   (32.768 kHz crystal)
-     * HFXIN / HFXOUT = PJ.6 / PJ.7   (8 MHz crystal)
-     *
-     * Selecting the "primary module function" on these pins connects them
-     * to the oscillator instead of using them as plain GPIO.
-     */
     GPIO_setAsPeripheralModuleFunctionInputPin(
         GPIO_PORT_PJ,
         GPIO_PIN4 | GPIO_PIN5,          /* LFXIN, LFXOUT */
@@ -36,6 +80,46 @@ void clock_init(void)
         GPIO_PORT_PJ,
         GPIO_PIN6 | GPIO_PIN7,          /* HFXIN, HFXOUT */
         GPIO_PRIMARY_MODULE_FUNCTION);
+}
+
+/* MCLK / SMCLK <- DCO at CONFIG_DCO_FREQ_HZ (8 MHz: DCORSEL = 1,
+ * DCOFSEL = 3), usable at once. HFXT is switched on here but not waited
+ * for. */
+static void clock_run_on_dco(void)
+{
+    CS_setDCOFreq(CS_DCORSEL_1, CS_DCOFSEL_3);
+    CS_initClockSignal(CS_MCLK,  CS_DCOCLK_SELECT, CS_CLOCK_DIVIDER_1);
+    CS_initClockSignal(CS_SMCLK, CS_DCOCLK_SELECT, CS_CLOCK_DIVIDER_1);
+    FRAMCtl_configureWaitStateControl(FRAMCTL_ACCESS_TIME_CYCLES_0);
+    s_mclk = CLOCK_MCLK_8MHZ;
+
+    (void)CS_turnOnHFXTWithTimeout(CS_HFXT_DRIVE_4MHZ_8MHZ, 1);
+}
+
+/* Program MCLK for s_mclk on what is running now. 16 MHz needs the DCO
+ * free for it, i.e. SMCLK on HFXT; until then it is served as 8 MHz. */
+static void clock_mclk_apply(void)
+{
+    uint16_t src = (s_xt_used & CLOCK_HFXT) ? CS_HFXTCLK_SELECT
+                                            : CS_DCOCLK_SELECT;
+
+    if (s_mclk == CLOCK_MCLK_16MHZ && (s_xt_used & CLOCK_HFXT))
+    {
+        FRAMCtl_configureWaitStateControl(FRAMCTL_ACCESS_TIME_CYCLES_1);
+        CS_initClockSignal(CS_MCLK, CS_DCOCLK_SELECT, CS_CLOCK_DIVIDER_1);
+        return;
+    }
+
+    CS_initClockSignal(CS_MCLK, src, (s_mclk == CLOCK_MCLK_1MHZ)
+                                     ? CS_CLOCK_DIVIDER_8
+                                     : CS_CLOCK_DIVIDER_1);
+    FRAMCtl_configureWaitStateControl(FRAMCTL_ACCESS_TIME_CYCLES_0);
+}
+
+void clock_init(void)
+{
+    /* --- 1. Configure the crystal pins on Port J --------------------- */
+    clock_pins();
 
     /* --- 2. Unlock the I/O held locked since power-up ----------------
      * Required before the crystals can drive their pins. Also clears the
@@ -49,23 +133,113 @@ void clock_init(void)
      */
     CS_setExternalClockSource(CONFIG_LFXT_FREQ_HZ, CONFIG_HFXT_FREQ_HZ);
 
-    /* --- 4. Start the crystals --------------------------------------
-     * These blocking calls turn on each oscillator and wait, clearing the
-     * oscillator-fault flags, until the crystal is stable.
-     *
-     * LF crystal: 32.768 kHz watch crystal -> lowest drive strength.
-     * HF crystal: 8 MHz -> the 4-8 MHz drive setting.
+    /* --- 4. Run on the internal oscillators -------------------------
+     * A cold crystal takes up to hundreds of ms to start; the firmware
+     * does not wait for it. ACLK runs from LFMODCLK (MODOSC / 128, about
+     * 39 kHz) meanwhile, so RTC and frame-gap times are some 20 % short
+     * until LFXT takes over.
      */
+    clock_run_on_dco();
+    CS_initClockSignal(CS_ACLK, CS_LFMODOSC_SELECT, CS_CLOCK_DIVIDER_1);
+    (void)CS_turnOnLFXTWithTimeout(CS_LFXT_DRIVE_0, 1);
+
+    s_xt_used  = 0;
+    s_xt_clear = 0;
+}
+
+void clock_resume(void)
+{
+    /* The LF crystal kept oscillating through LPM3.5 for the RTC, but CS
+     * has come out of the wake-up reset with LFXTOFF set. Turn it back on
+     * while the pins are still locked, or it stops on the unlock and the
+     * RTC loses time. It is running, so this wait is short. */
+    clock_pins();
+    CS_setExternalClockSource(CONFIG_LFXT_FREQ_HZ, CONFIG_HFXT_FREQ_HZ);
     CS_turnOnLFXT(CS_LFXT_DRIVE_0);
-    CS_turnOnHFXT(CS_HFXT_DRIVE_4MHZ_8MHZ);
+    CS_initClockSignal(CS_ACLK, CS_LFXTCLK_SELECT, CS_CLOCK_DIVIDER_1);
 
-    /* --- 5. Route the system clocks ---------------------------------
-     * MCLK  <- HFXT (8 MHz)      : CPU
-     * SMCLK <- HFXT (8 MHz)      : UART / I2C / ADC / timers
-     * ACLK  <- LFXT (32.768 kHz) : RTC / low-power wakeup
-     * Divider /1 = use the source frequency directly.
-     */
-    CS_initClockSignal(CS_MCLK,  CS_HFXTCLK_SELECT, CS_CLOCK_DIVIDER_1);
-    CS_initClockSignal(CS_SMCLK, CS_HFXTCLK_SELECT, CS_CLOCK_DIVIDER_1);
-    CS_initClockSignal(CS_ACLK,  CS_LFXTCLK_SELECT, CS_CLOCK_DIVIDER_1);
+    /* Pins the caller has configured take effect now, glitch-free. */
+    PMM_unlockLPM5();
+
+    /* HFXT was off: run on the DCO until clock_poll() sees it settled. */
+    clock_run_on_dco();
+    s_xt_used  = CLOCK_LFXT;
+    s_xt_clear = 0;
+}
+
+/* Check one crystal (`xt` = CLOCK_LFXT / CLOCK_HFXT): settled if its
+ * fault flag was clear when the previous poll left and still is now.
+ * Otherwise clear the flag (and the global OFIFG it raised) and mark it
+ * clear for the next poll to confirm. */
+static bool clock_xt_settled(uint8_t fault_flag, uint8_t xt)
+{
+    if (CS_getFaultFlagStatus(fault_flag) == 0)
+    {
+        if (s_xt_clear & xt)
+            return true;
+    }
+    else
+    {
+        CS_clearFaultFlag(fault_flag);
+        SFR_clearInterrupt(SFR_OSCILLATOR_FAULT_INTERRUPT);
+    }
+    s_xt_clear |= xt;
+    return false;
+}
+
+uint8_t clock_poll(void)
+{
+    if (!(s_xt_used & CLOCK_LFXT) &&
+        clock_xt_settled(CS_LFXTOFFG, CLOCK_LFXT))
+    {
+        (void)CS_turnOnLFXTWithTimeout(CS_LFXT_DRIVE_0, 1);
+        CS_initClockSignal(CS_ACLK, CS_LFXTCLK_SELECT, CS_CLOCK_DIVIDER_1);
+        s_xt_used |= CLOCK_LFXT;
+    }
+
+    if (!(s_xt_used & CLOCK_HFXT) &&
+        clock_xt_settled(CS_HFXTOFFG, CLOCK_HFXT))
+    {
+        /* Both at the same rate, so the UART divisors stand; with
+         * interrupts off no UART ISR runs half on one clock and half on
+         * the other, and the CS switch itself is glitch-free. */
+        uint16_t gie = __get_SR_register() & GIE;
+        __disable_interrupt();
+        (void)CS_turnOnHFXTWithTimeout(CS_HFXT_DRIVE_4MHZ_8MHZ, 1);
+        CS_initClockSignal(CS_SMCLK, CS_HFXTCLK_SELECT, CS_CLOCK_DIVIDER_1);
+        CS_initClockSignal(CS_MCLK,  CS_HFXTCLK_SELECT,
+                           (s_mclk == CLOCK_MCLK_1MHZ) ? CS_CLOCK_DIVIDER_8
+                                                       : CS_CLOCK_DIVIDER_1);
+        s_xt_used |= CLOCK_HFXT;
+
+        /* The DCO now drives nothing: retune it for CLOCK_MCLK_16MHZ.
+         * Not CS_setDCOFreq(), which drops MCLK and SMCLK to /4 while the
+         * DCO settles and so would stretch a UART bit on HFXT. */
+        CSCTL0_H = CSKEY_H;
+        CSCTL1   = DCORSEL | DCOFSEL_4;
+        CSCTL0_H = 0;
+        __bis_SR_register(gie);
+
+        if (s_mclk == CLOCK_MCLK_16MHZ)
+            clock_mclk_apply();
+    }
+
+    return s_xt_used;
+}
+
+uint8_t clock_set_mclk(uint8_t level)
+{
+    if (level != s_mclk)
+    {
+        s_mclk = level;
+        clock_mclk_apply();
+    }
+    return clock_get_mclk();
+}
+
+uint8_t clock_get_mclk(void)
+{
+    if (s_mclk == CLOCK_MCLK_16MHZ && !(s_xt_used & CLOCK_HFXT))
+        return CLOCK_MCLK_8MHZ;
+    return s_mclk;
 }
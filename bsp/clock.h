@@ -6,6 +6,14 @@
  *   SMCLK = 8 MHz      (from HF crystal)  -> UART / I2C / ADC / timers
  *   ACLK  = 32.768 kHz (from LF crystal)  -> RTC / low-power wakeup
  *
+ * The device boots on the internal oscillators instead, without waiting
+ * for the crystals: MCLK / SMCLK from the DCO at the same 8 MHz (so every
+ * divisor is already right, only less accurate), ACLK from LFMODCLK. Each
+ * crystal takes over once clock_poll() sees it settled.
+ *
+ * MCLK can be scaled per task with clock_set_mclk() (1 / 8 / 16 MHz);
+ * SMCLK and ACLK never change with it.
+ *
  * The USS module's dedicated 8 MHz crystal is NOT handled here; it is set
  * up later by USSLib (Phase 11).
  */
@@ -13,9 +21,22 @@
 #ifndef BSP_CLOCK_H_
 #define BSP_CLOCK_H_
 
+#include <stdint.h>
+
+/* clock_poll() result bits: crystal in use. */
+#define CLOCK_LFXT      0x01    /* ACLK from LFXT                */
+#define CLOCK_HFXT      0x02    /* MCLK / SMCLK from HFXT        */
+#define CLOCK_ALL       (CLOCK_LFXT | CLOCK_HFXT)
+
+/* MCLK levels for clock_set_mclk(). */
+#define CLOCK_MCLK_1MHZ     0   /* HFXT / 8: CPU mostly waiting        */
+#define CLOCK_MCLK_8MHZ     1   /* HFXT: the default, 0 FRAM waits     */
+#define CLOCK_MCLK_16MHZ    2   /* DCO at 16 MHz, 1 FRAM wait state    */
+
 /*
- * clock_init() — bring up the LF and HF crystals and route them to the
- * system clocks (MCLK, SMCLK, ACLK). Blocks until both crystals are stable.
+ * clock_init() — start the system clocks on the DCO / LFMODCLK and switch
+ * both crystals on. Returns at once; call clock_poll() until it reports
+ * CLOCK_ALL.
  *
  * Must be called early in startup, after the watchdog is stopped. It calls
  * PMM_unlockLPM5() internally, which unlocks the GPIO/crystal pins that the
@@ -23,4 +44,33 @@
  */
 void clock_init(void);
 
+/*
+ * clock_resume() — clock_init() for the wake-up from LPM3.5 (see
+ * bsp/power.h). Keeps the LF crystal, which ran on for the RTC, going
+ * across the I/O unlock, so ACLK is on LFXT at once; HFXT is left to
+ * clock_poll() as after clock_init(). Configure the pins first: they stay
+ * latched as they were during the sleep until this releases them.
+ */
+void clock_resume(void);
+
+/*
+ * clock_poll() — check the crystals still starting, move each clock onto
+ * its crystal once that is settled, and return the CLOCK_* bits in use.
+ * Non-blocking; meant to run every CLOCK_XT_POLL_MS (a crystal counts as
+ * settled when its fault flag stays clear from one poll to the next).
+ */
+uint8_t clock_poll(void);
+
+/*
+ * clock_set_mclk() — run MCLK at CLOCK_MCLK_* `level` from now on, with
+ * the FRAM wait states it needs, and return the level in effect:
+ * CLOCK_MCLK_16MHZ comes out as CLOCK_MCLK_8MHZ until HFXT is in use
+ * (the DCO is SMCLK's source until then). Main-loop context only.
+ * clock_init() and clock_resume() start at CLOCK_MCLK_8MHZ.
+ */
+uint8_t clock_set_mclk(uint8_t level);
+
+/* clock_get_mclk() — the CLOCK_MCLK_* level MCLK runs at now. */
+uint8_t clock_get_mclk(void);
+
 #endif /* BSP_CLOCK_H_ */
@@ -0,0 +1,24 @@
+/*
+ * bsp/crc.c — on-chip CRC16 module implementation.
+ *
+ * See bsp/crc.h. The module needs no init or clock: a seed write resets
+ * it, and every data write updates the result within one MCLK cycle.
+ */
+
+#include <msp430.h>
+#include "driverlib/MSP430FR5xx_6xx/driverlib.h"
+#include "bsp/crc.h"
+
+uint16_t crc_hw_ccitt(uint16_t seed, const uint8_t *data, uint16_t len)
+{
+    uint16_t i;
+
+    CRC_setSeed(CRC_BASE, seed);
+
+    /* CRCDIRB reverses each byte's bits on the way in, which turns the
+     * module's LSB-first engine into the MSB-first CCITT calculation. */
+    for (i = 0; i < len; i++)
+        CRC_set8BitDataReversed(CRC_BASE, data[i]);
+
+    return CRC_getResult(CRC_BASE);
+}
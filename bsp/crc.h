@@ -0,0 +1,23 @@
+/*
+ * bsp/crc.h — on-chip CRC16 module (BSP layer, driverlib wrapper).
+ *
+ * The MSP430 CRC16 module implements the CRC-CCITT polynomial (0x1021)
+ * in hardware, one byte per write. Feeding bytes through the bit-reversed
+ * input register (CRCDIRB) and reading CRCINIRES gives the standard
+ * MSB-first CCITT result, i.e. the same value as the software backends in
+ * drivers/crc16. The polynomial is fixed, so the Modbus CRC cannot use it.
+ */
+
+#ifndef BSP_CRC_H_
+#define BSP_CRC_H_
+
+#include <stdint.h>
+
+/*
+ * crc_hw_ccitt() — run `len` bytes through the CRC16 module starting from
+ * `seed` and return the result. The module holds a single running CRC, so
+ * this must not be called from an ISR while the main loop is using it.
+ */
+uint16_t crc_hw_ccitt(uint16_t seed, const uint8_t *data, uint16_t len);
+
+#endif /* BSP_CRC_H_ */
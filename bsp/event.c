@@ -0,0 +1,54 @@
+/*
+ * bsp/event.c — wake-source event bits implementation.
+ *
+ * See bsp/event.h. The whole queue is one byte: a post is a single
+ * read-modify-write (BIS.B, atomic on the MSP430), and event_wait() takes
+ * and clears it with interrupts off.
+ */
+
+#include <msp430.h>
+#include "bsp/power.h"
+#include "bsp/timer.h"
+#include "bsp/event.h"
+
+static volatile uint8_t s_pending = 0;
+
+void event_post(uint8_t bits)
+{
+    s_pending |= bits;
+}
+
+uint8_t event_wait(void)
+{
+    uint8_t ev;
+
+    for (;;)
+    {
+        /* Check-then-sleep with interrupts off: an ISR that posts between
+         * the test and the LPM entry cannot be missed, because GIE is only
+         * set by the same instruction that enters the LPM. */
+        __disable_interrupt();
+        ev = s_pending;
+        if (ev)
+        {
+            s_pending = 0;
+            __enable_interrupt();
+            return ev;
+        }
+        power_enter_sleep();
+    }
+}
+
+uint8_t event_wait_deep(void)
+{
+    __disable_interrupt();
+    if (!s_pending && rtc_deep_enter())
+    {
+        power_enter_deep_sleep();     /* same check-then-sleep as above */
+        __disable_interrupt();
+        rtc_deep_leave();             /* an ISR ended the attempt */
+    }
+    __enable_interrupt();
+
+    return event_wait();
+}
@@ -0,0 +1,51 @@
+/*
+ * bsp/event.h — wake-source event bits (BSP layer).
+ *
+ * Every interrupt that has work for the main loop posts one bit here and
+ * wakes the CPU; the main loop takes all pending bits at once, runs the
+ * matching handlers, and goes back to sleep only when none are left.
+ * Adding a wake source = one new bit + one event_post() in its ISR.
+ *
+ * A bit means "look at this source", not "one item": the source keeps its
+ * own queue (e.g. the RS485 frame queue), so several posts before the main
+ * loop gets to them collapse into one without losing anything.
+ */
+
+#ifndef BSP_EVENT_H_
+#define BSP_EVENT_H_
+
+#include <stdint.h>
+
+#define EVT_RTC         0x01    /* an RTC deadline expired (bsp/timer)     */
+#define EVT_RS485_RX    0x02    /* complete RS485 frame queued (bsp/uart)  */
+#define EVT_FAULT       0x04    /* charger fault (source: Phase 8 LT8490)  */
+#define EVT_BUTTON      0x08    /* a front-panel button was pressed        */
+#define EVT_HMI_RX      0x10    /* byte(s) received from the HMI screen    */
+#define EVT_MOTOR_STALL 0x20    /* motor current over the stall threshold
+                                   (bsp/adc window comparator)             */
+
+/*
+ * event_post() — mark `bits` pending. Safe from ISRs and from main. An ISR
+ * must still clear the LPM bits on exit itself (__bic_SR_register_on_exit)
+ * so the main loop runs after it.
+ */
+void event_post(uint8_t bits);
+
+/*
+ * event_wait() — return and clear all pending bits; if there are none,
+ * sleep (power_enter_sleep) until an ISR posts one. Race-free: the check
+ * and the sleep happen with interrupts off until the LPM entry itself.
+ */
+uint8_t event_wait(void);
+
+/*
+ * event_wait_deep() — as event_wait(), but if no bit is pending, try
+ * LPM3.5 first (power_enter_deep_sleep), with the RTC schedule handed to
+ * the calendar alarm for it (rtc_deep_enter). Waking from there is a
+ * reset, so this returns only if an ISR ended the attempt; it then takes
+ * the schedule back (rtc_deep_leave) and carries on as event_wait(). The
+ * caller must have put everything LPM3.5 loses in FRAM.
+ */
+uint8_t event_wait_deep(void);
+
+#endif /* BSP_EVENT_H_ */
@@ -2,7 +2,7 @@
  * bsp/gpio_init.c — Global GPIO configuration implementation.
  *
  * Phase 2 scope: configure the LEDs (outputs, off) and the buttons
- * (pull-up inputs). Other pins (motor, USS, RS485, ±15V, LT8490, HMI)
+ * (pull-up inputs, falling-edge interrupt -> EVT_BUTTON). Other pins (motor, USS, RS485, ±15V, LT8490, HMI)
  * are added to this function in their own phases.
  *
  * The LCD_C module is disabled by default after a BOR reset, so the
@@ -13,6 +13,7 @@
 #include <msp430.h>
 #include "driverlib/MSP430FR5xx_6xx/driverlib.h"
 #include "config.h"
+#include "bsp/event.h"
 #include "bsp/gpio_init.h"
 
 void gpio_init(void)
@@ -35,6 +36,13 @@ void gpio_init(void)
     GPIO_setAsInputPinWithPullUpResistor(BTN_UP_PORT,     BTN_UP_PIN);
     GPIO_setAsInputPinWithPullUpResistor(BTN_RIGHT_PORT,  BTN_RIGHT_PIN);
 
+    /* Press = falling edge. Each press posts EVT_BUTTON (ISR below); the
+     * app reads the pins to see which. All five buttons share port 5. */
+    GPIO_selectInterruptEdge(BTN_PORT, BTN_ALL_PINS,
+                             GPIO_HIGH_TO_LOW_TRANSITION);
+    GPIO_clearInterrupt(BTN_PORT, BTN_ALL_PINS);
+    GPIO_enableInterrupt(BTN_PORT, BTN_ALL_PINS);
+
     /* --- HMI screen control lines (Phase 12) ------------------------
      * AUDIO-PA-EN is active-low for audio, so drive it HIGH to keep the
      * screen's audio amplifier OFF (saves a little current and avoids
@@ -53,3 +61,17 @@ void gpio_init(void)
     GPIO_setAsOutputPin(HMI_PE8_PORT, HMI_PE8_PIN);
     GPIO_setOutputLowOnPin(HMI_PE8_PORT, HMI_PE8_PIN);
 }
+
+/* Port 5 interrupt — a button went low. Reading P5IV clears the flag of
+ * the pin it reports; contact bounce just re-posts the same bit, which
+ * the main loop sees as one event.
+ */
+#pragma vector = PORT5_VECTOR
+__interrupt void port5_isr(void)
+{
+    if (__even_in_range(P5IV, P5IV__P5IFG7) != P5IV__NONE)
+    {
+        event_post(EVT_BUTTON);
+        __bic_SR_register_on_exit(LPM3_bits);
+    }
+}
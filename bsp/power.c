@@ -6,6 +6,7 @@
  */
 
 #include <msp430.h>
+#include "driverlib/MSP430FR5xx_6xx/driverlib.h"
 #include "bsp/power.h"
 
 void power_enter_sleep(void)
@@ -15,3 +16,20 @@ void power_enter_sleep(void)
      */
     __bis_SR_register(LPM3_bits | GIE);
 }
+
+void power_enter_deep_sleep(void)
+{
+    /* With PMMREGOFF set, the LPM3 entry becomes LPM3.5. An ISR that
+     * leaves the LPM bits alone lets the CPU drop back into it. */
+    PMM_turnOffRegulator();
+    __bis_SR_register(LPM3_bits | GIE);
+    PMM_turnOnRegulator();
+}
+
+uint8_t power_woke_from_deep_sleep(void)
+{
+    if (PMM_getInterruptStatus(PMM_LPM5_INTERRUPT) == 0)
+        return 0;
+    PMM_clearInterrupt(PMM_LPM5_INTERRUPT);
+    return 1;
+}
@@ -1,9 +1,11 @@
 /*
  * bsp/power.h — Low-power mode entry (BSP layer).
  *
- * Phase 5 scope: enter sleep. Code requests LPM3; if a peripheral (e.g. the
- * RS485 UART, added later) is requesting SMCLK, the device actually settles
- * in LPM1 — this is expected (see CLAUDE.md §4).
+ * Phase 5 scope: enter sleep. Code requests LPM3; if a peripheral is
+ * requesting SMCLK, the device actually settles in LPM1 — this is expected
+ * (see CLAUDE.md §4). The RS485 UART only does so while traffic is going
+ * on: once the link is quiet it drops into listen mode (bsp/uart.c) and
+ * releases SMCLK, so idle sleep is true LPM3.
  *
  * (The ±15 V opamp-supply enable helper is added here in the USS phase.)
  */
@@ -17,4 +19,22 @@
  */
 void power_enter_sleep(void);
 
+/*
+ * power_enter_deep_sleep() — as power_enter_sleep(), but LPM3.5: the core
+ * regulator is switched off, RAM and every peripheral but the RTC_C and
+ * the port wake logic are lost, and the pins are latched as they are. The
+ * wake-up (RTC interrupt or port edge) is a reset through main() with
+ * power_woke_from_deep_sleep() true. Returns only if an interrupt was
+ * pending at entry and its ISR kept the CPU awake; LPM3.5 is then off
+ * again.
+ */
+void power_enter_deep_sleep(void);
+
+/*
+ * power_woke_from_deep_sleep() — non-zero if this reset is the wake-up
+ * from power_enter_deep_sleep(). Clears the indication, so call it once,
+ * early in startup.
+ */
+uint8_t power_woke_from_deep_sleep(void);
+
 #endif /* BSP_POWER_H_ */
@@ -1,78 +1,531 @@
 /*
- * bsp/timer.c — RTC periodic wake-up implementation.
+ * bsp/timer.c — tickless RTC deadline scheduler implementation.
  *
- * The RTC_C runs in calendar mode, clocked from the 32.768 kHz LF crystal.
- * In calendar mode the internal prescalers auto-divide to 1 Hz, and the
- * "clock read ready" (RTCRDY) interrupt fires once per second. The ISR
- * counts those seconds and raises a flag every MEASURE_INTERVAL_S.
+ * The RTC_C runs in 32-bit counter mode, clocked from the 32.768 kHz LF
+ * crystal through the RT1PS prescaler (/256 = 128 Hz ticks). There is no
+ * compare register in counter mode, so each deadline is armed by preloading
+ * the counter with -(ticks until the nearest deadline): the 32-bit overflow
+ * event (RTCTEVIFG) then fires exactly on that deadline and at no other
+ * time. Between deadlines the CPU is never woken, whatever the interval.
  *
- * (Counter mode + a manual prescale event would need the RT0PS/RT1PS clock
- * sources configured explicitly; calendar mode gives a clean 1 Hz for free.)
+ * Every deadline keeps its remaining ticks relative to the last preload
+ * (s_load). rtc_service() measures the time elapsed since then, fires what
+ * is due, and preloads the counter for the next one. It runs from the ISR
+ * and, with interrupts disabled, whenever a deadline is (re)scheduled.
+ *
+ * The schedule state below is kept in FRAM (#pragma PERSISTENT), and
+ * rtc_init() starts it afresh after any reset but the LPM3.5 wake-up.
+ *
+ * LPM3.5 cannot use counter mode: the counter is clocked through RT1PS
+ * from ACLK, and the clock system is off in LPMx.5. What the family
+ * user's guide (SLAU367, RTC_C chapter, LPMx.5 operation) keeps running
+ * there is the RTC_C in calendar mode, clocked straight from the LF
+ * crystal, with its interrupts as wake-up sources. So rtc_deep_enter()
+ * hands the next deadline over to calendar mode: the clock is set so
+ * that it reaches hh:mm:00 exactly on the deadline, and the minute/hour
+ * alarm wakes the device there. rtc_deep_leave() (an aborted attempt)
+ * or rtc_resume() (after the wake-up reset) reads how far the calendar
+ * got, returns to counter mode and services the schedule for that much
+ * time, uptime included.
+ *
+ * (The old calendar mode gave a clean 1 Hz RTCRDY tick, but that meant one
+ * wake-up per second even when work is due once a minute.)
  */
 
 #include <msp430.h>
 #include "driverlib/MSP430FR5xx_6xx/driverlib.h"
 #include "config.h"
+#include "bsp/event.h"
 #include "bsp/timer.h"
 
-/* Shared with the ISR. volatile: the ISR writes these behind the main
- * loop's back, so the compiler must not cache them. */
-static volatile uint16_t s_seconds         = 0;
-static volatile uint8_t  s_measurement_due = 0;
+#if RTC_NUM_DEADLINES > 8
+#error "RTC_NUM_DEADLINES: the due mask is 8 bits"
+#endif
+
+typedef struct {
+    uint32_t remaining;     /* ticks left, counted from s_load          */
+    uint32_t period;        /* reload for periodic deadlines, 0 = once  */
+    uint8_t  active;
+} rtc_deadline_t;
+
+#pragma PERSISTENT(s_dl)
+static rtc_deadline_t s_dl[RTC_NUM_DEADLINES] = {{0}};
+#pragma PERSISTENT(s_load)
+static uint32_t       s_load = 0;       /* last value preloaded          */
+
+/* Uptime, advanced by every rtc_service(): whole seconds plus the ticks
+ * (< RTC_TICKS_PER_S) not yet making up a second. */
+#pragma PERSISTENT(s_up_s)
+static uint32_t       s_up_s = 0;
+#pragma PERSISTENT(s_up_ticks)
+static uint8_t        s_up_ticks = 0;
+
+/* One bit per deadline that has expired and not been cleared yet. Shared
+ * with the ISR, so volatile. */
+#pragma PERSISTENT(s_due_mask)
+static volatile uint8_t s_due_mask = 0;
+
+/* Calendar mode across LPM3.5: where the calendar was started and where
+ * its alarm is, in ticks since 00:00:00. */
+#define RTC_TICKS_PER_MIN   (60UL * RTC_TICKS_PER_S)
+#define RTC_CAL_MAX_MIN     (24u * 60u - 1u)      /* alarm at 23:59 */
+
+#pragma PERSISTENT(s_cal_start)
+static uint32_t       s_cal_start = 0;
+#pragma PERSISTENT(s_cal_alarm)
+static uint32_t       s_cal_alarm = 0;
+
+/* RTCTIM0/RTCTIM1 are read as two words while the counter runs from ACLK:
+ * re-read until two samples agree so a carry between them is not torn. */
+static uint32_t rtc_read_counter(void)
+{
+    uint32_t a, b;
+    do {
+        a = RTC_C_getCounterValue(RTC_C_BASE);
+        b = RTC_C_getCounterValue(RTC_C_BASE);
+    } while (a != b);
+    return a;
+}
+
+/* Account for `elapsed` ticks since the last preload: advance the
+ * uptime, fire expired deadlines and return the ticks to the nearest one
+ * left in *next (0xFFFFFFFF: none). Returns non-zero if any fired. */
+static uint8_t rtc_advance(uint32_t elapsed, uint32_t *next)
+{
+    uint8_t fired = 0;
+    uint8_t i;
+
+    *next = 0xFFFFFFFFUL;                         /* nothing pending */
+
+    {
+        uint32_t t = s_up_ticks + elapsed;
+        s_up_s    += t / RTC_TICKS_PER_S;
+        s_up_ticks = (uint8_t)(t % RTC_TICKS_PER_S);
+    }
+
+    for (i = 0; i < RTC_NUM_DEADLINES; i++)
+    {
+        rtc_deadline_t *d = &s_dl[i];
+        if (!d->active)
+            continue;
+
+        if (d->remaining <= elapsed)
+        {
+            s_due_mask |= (uint8_t)(1u << i);
+            fired = 1;
+
+            if (d->period)
+            {
+                /* Reload from the exact deadline, not from now, so a
+                 * late service does not make the period drift. */
+                uint32_t late = elapsed - d->remaining;
+                d->remaining = (late < d->period) ? d->period - late : 1;
+            }
+            else
+            {
+                d->active = 0;
+                continue;
+            }
+        }
+        else
+        {
+            d->remaining -= elapsed;
+        }
+
+        if (d->remaining < *next)
+            *next = d->remaining;
+    }
+
+    return fired;
+}
+
+/* Preload so the 32-bit overflow lands on the nearest deadline, `next`
+ * ticks away. The counter is held for the two-word write (a tick landing
+ * inside this window is lost, < 8 ms per reschedule). */
+static void rtc_preload(uint32_t next)
+{
+    s_load = (uint32_t)(0UL - next);
+    RTC_C_holdClock(RTC_C_BASE);
+    RTC_C_setCounterValue(RTC_C_BASE, s_load);
+    RTC_C_clearInterrupt(RTC_C_BASE, RTC_C_TIME_EVENT_INTERRUPT);
+    RTC_C_startClock(RTC_C_BASE);
+}
+
+/* Account for the time since the last preload, fire expired deadlines and
+ * arm the counter for the next one. Caller has interrupts disabled (or is
+ * the ISR). Returns non-zero if any deadline fired. */
+static uint8_t rtc_service(void)
+{
+    uint32_t next;
+    uint8_t  fired = rtc_advance(rtc_read_counter() - s_load, &next);
+
+    rtc_preload(next);
+    return fired;
+}
+
+/* Counter mode, held: 128 Hz ticks = ACLK / 256 via RT1PS; event = 32-bit
+ * overflow, so one preload reaches up to 2^32 ticks (~388 days). */
+static void rtc_counter_mode(void)
+{
+    RTC_C_initCounterPrescale(RTC_C_BASE, RTC_C_PRESCALE_1,
+                              RTC_C_PSCLOCKSELECT_ACLK, RTC_C_PSDIVIDER_256);
+    RTC_C_initCounter(RTC_C_BASE, RTC_C_CLOCKSELECT_RT1PS,
+                      RTC_C_COUNTERSIZE_32BIT);
+}
+
+/* Calendar position in ticks since 00:00:00, and the LF crystal cycles
+ * (RT0PS, 0..255) into the current tick. In calendar mode RT0PS divides
+ * the crystal by 256 into RT1PS, whose low 7 bits count the ticks of the
+ * second. The registers update asynchronously: read until two passes
+ * agree. */
+static uint32_t rtc_cal_read(uint8_t *cycles)
+{
+    uint16_t tim0, tim1;
+    uint8_t  ps0, ps1;
+
+    do {
+        tim0 = RTCTIM0;
+        tim1 = RTCTIM1;
+        ps1  = RTC_C_getPrescaleValue(RTC_C_BASE, RTC_C_PRESCALE_1);
+        ps0  = RTC_C_getPrescaleValue(RTC_C_BASE, RTC_C_PRESCALE_0);
+    } while (tim0 != RTCTIM0 || tim1 != RTCTIM1 ||
+             ps1 != RTC_C_getPrescaleValue(RTC_C_BASE, RTC_C_PRESCALE_1));
+
+    *cycles = ps0;
+    return ((uint32_t)(tim1 & 0xFF) * 3600UL +       /* RTCHOUR */
+            (uint32_t)(tim0 >> 8)   * 60UL +         /* RTCMIN  */
+            (uint32_t)(tim0 & 0xFF)) * RTC_TICKS_PER_S +
+           (ps1 & 0x7F);
+}
+
+/* Back from calendar mode: account for the time it ran, return to counter
+ * mode and arm it for the next deadline. Returns non-zero if any deadline
+ * fired; *since_alarm = the ACLK cycles since the alarm time (saturating
+ * at 0xFFFF), 0 if it has not been reached. */
+static uint8_t rtc_cal_leave(uint16_t *since_alarm)
+{
+    uint8_t  cycles;
+    uint32_t now = rtc_cal_read(&cycles);
+    uint32_t next;
+    uint8_t  fired;
+
+    *since_alarm = 0;
+    if (now >= s_cal_alarm)
+    {
+        uint32_t t = now - s_cal_alarm;
+        *since_alarm = (t < 256UL) ? (uint16_t)((t << 8) | cycles) : 0xFFFFu;
+        if (*since_alarm == 0)
+            *since_alarm = 1;
+    }
+
+    RTC_C_disableInterrupt(RTC_C_BASE, RTC_C_CLOCK_ALARM_INTERRUPT);
+    RTC_C_clearInterrupt(RTC_C_BASE, RTC_C_CLOCK_ALARM_INTERRUPT);
+    rtc_counter_mode();
+
+    fired = rtc_advance((now >= s_cal_start) ? now - s_cal_start : 0, &next);
+    rtc_preload(next);
+    RTC_C_enableInterrupt(RTC_C_BASE, RTC_C_TIME_EVENT_INTERRUPT);
+    return fired;
+}
 
 void rtc_init(void)
 {
-    /* Calendar mode needs a starting time; the exact value is irrelevant
-     * here — we only use the 1 Hz "seconds updated" (RTCRDY) interrupt, not
-     * the wall-clock time.
-     */
-    Calendar startTime;
-    startTime.Seconds    = 0;
-    startTime.Minutes    = 0;
-    startTime.Hours      = 0;
-    startTime.DayOfWeek  = 0;
-    startTime.DayOfMonth = 1;
-    startTime.Month      = 1;
-    startTime.Year       = 2025;
-
-    RTC_C_initCalendar(RTC_C_BASE, &startTime, RTC_C_FORMAT_BINARY);
-
-    /* RTCRDY asserts once per second when the seconds register updates. */
-    RTC_C_clearInterrupt(RTC_C_BASE, RTC_C_CLOCK_READ_READY_INTERRUPT);
-    RTC_C_enableInterrupt(RTC_C_BASE, RTC_C_CLOCK_READ_READY_INTERRUPT);
+    uint8_t i;
+    for (i = 0; i < RTC_NUM_DEADLINES; i++)
+        s_dl[i].active = 0;
+    s_due_mask = 0;
+    s_load = 0;
+    s_up_s = 0;
+    s_up_ticks = 0;
+
+    /* Counter mode whatever a previous run left (the calendar, if it
+     * reset in the middle of a deep sleep). */
+    RTC_C_disableInterrupt(RTC_C_BASE, RTC_C_CLOCK_ALARM_INTERRUPT);
+    rtc_counter_mode();
+    RTC_C_setCounterValue(RTC_C_BASE, 0);
+
+    RTC_C_clearInterrupt(RTC_C_BASE, RTC_C_TIME_EVENT_INTERRUPT);
+    RTC_C_enableInterrupt(RTC_C_BASE, RTC_C_TIME_EVENT_INTERRUPT);
+    RTC_C_startClock(RTC_C_BASE);
+
+    /* The measurement cycle is the one deadline that always exists. */
+    rtc_schedule(RTC_DL_MEASURE, RTC_SECONDS(MEASURE_INTERVAL_S),
+                 RTC_SECONDS(MEASURE_INTERVAL_S));
+}
+
+uint16_t rtc_resume(void)
+{
+    uint16_t aclk = 0;
+
+    if (RTCCTL13 & RTCMODE)
+    {
+        /* The calendar ran the sleep. Deadlines it covered are due now;
+         * the main loop sees them as soon as it starts. */
+        if (rtc_cal_leave(&aclk))
+            event_post(EVT_RTC);
+        return aclk;
+    }
+
+    /* No calendar hand-over (cannot happen after rtc_deep_enter()): carry
+     * on in counter mode, a pending deadline is serviced by the ISR as
+     * soon as interrupts are enabled. */
+    RTC_C_enableInterrupt(RTC_C_BASE, RTC_C_TIME_EVENT_INTERRUPT);
+    return aclk;
+}
+
+uint8_t rtc_deep_enter(void)
+{
+    uint32_t next;
+    uint32_t start;
+    uint16_t min;
+    Calendar cal = {0};
+    RTC_C_configureCalendarAlarmParam alarm = {0};
+
+    /* Bring the schedule up to now; anything due is for the main loop,
+     * not for a sleep. */
+    if (rtc_advance(rtc_read_counter() - s_load, &next))
+    {
+        rtc_preload(next);
+        event_post(EVT_RTC);
+        return 0;
+    }
+
+    /* Alarm on the minute boundary `min` minutes on; start the calendar
+     * `next` ticks before it. Further than the calendar day reaches, wake
+     * at its end and sleep again for the rest. */
+    if (next > (uint32_t)RTC_CAL_MAX_MIN * RTC_TICKS_PER_MIN)
+        next = (uint32_t)RTC_CAL_MAX_MIN * RTC_TICKS_PER_MIN;
+    min   = (uint16_t)((next + RTC_TICKS_PER_MIN - 1) / RTC_TICKS_PER_MIN);
+    start = (uint32_t)min * RTC_TICKS_PER_MIN - next;
 
+    RTC_C_holdClock(RTC_C_BASE);
+    RTC_C_disableInterrupt(RTC_C_BASE, RTC_C_TIME_EVENT_INTERRUPT);
+    RTCCTL0_H = RTCKEY_H;
+    RTCCTL13 |= RTCMODE;                /* calendar, from the LF crystal */
+    RTCCTL0_H = 0;
+
+    cal.Seconds    = (uint8_t)((start / RTC_TICKS_PER_S) % 60u);
+    cal.Minutes    = (uint8_t)((start / RTC_TICKS_PER_MIN) % 60u);
+    cal.Hours      = (uint8_t)(start / (60UL * RTC_TICKS_PER_MIN));
+    cal.DayOfMonth = 1;
+    cal.Month      = 1;
+    RTC_C_initCalendar(RTC_C_BASE, &cal, RTC_C_FORMAT_BINARY);
+    RTC_C_setPrescaleValue(RTC_C_BASE, RTC_C_PRESCALE_0, 0);
+    RTC_C_setPrescaleValue(RTC_C_BASE, RTC_C_PRESCALE_1,
+                           (uint8_t)(start % RTC_TICKS_PER_S));
+
+    alarm.minutesAlarm    = (uint8_t)(min % 60u);
+    alarm.hoursAlarm      = (uint8_t)(min / 60u);
+    alarm.dayOfWeekAlarm  = RTC_C_ALARMCONDITION_OFF;
+    alarm.dayOfMonthAlarm = RTC_C_ALARMCONDITION_OFF;
+    RTC_C_configureCalendarAlarm(RTC_C_BASE, &alarm);
+
+    /* Measure from what the RTC actually holds, not from what was asked
+     * for: the alarm stays on the boundary either way. */
+    {
+        uint8_t cycles;
+        s_cal_start = rtc_cal_read(&cycles);
+    }
+    s_cal_alarm = (uint32_t)min * RTC_TICKS_PER_MIN;
+
+    RTC_C_clearInterrupt(RTC_C_BASE, RTC_C_CLOCK_ALARM_INTERRUPT |
+                                     RTC_C_TIME_EVENT_INTERRUPT);
+    RTC_C_enableInterrupt(RTC_C_BASE, RTC_C_CLOCK_ALARM_INTERRUPT);
     RTC_C_startClock(RTC_C_BASE);
+    return 1;
+}
+
+void rtc_deep_leave(void)
+{
+    uint16_t since_alarm;
+
+    if (rtc_cal_leave(&since_alarm))
+        event_post(EVT_RTC);
+}
+
+uint32_t rtc_ticks_to_next(void)
+{
+    uint32_t next = 0xFFFFFFFFUL;
+    uint8_t  i;
+
+    uint16_t gie = __get_SR_register() & GIE;
+    __disable_interrupt();
+
+    uint32_t elapsed = rtc_read_counter() - s_load;
+    for (i = 0; i < RTC_NUM_DEADLINES; i++)
+    {
+        if (!s_dl[i].active)
+            continue;
+        if (s_dl[i].remaining <= elapsed)
+        {
+            next = 0;
+            break;
+        }
+        if (s_dl[i].remaining - elapsed < next)
+            next = s_dl[i].remaining - elapsed;
+    }
+
+    __bis_SR_register(gie);
+    return next;
+}
+
+void rtc_schedule(uint8_t id, uint32_t ticks, uint32_t period)
+{
+    if (id >= RTC_NUM_DEADLINES)
+        return;
+    if (ticks == 0)
+        ticks = 1;
+
+    uint16_t gie = __get_SR_register() & GIE;
+    __disable_interrupt();
+
+    /* Bring everyone up to "now" first; the new deadline then counts from
+     * the fresh preload. Either service also clears RTCTEVIFG, so anything
+     * that expires here has to be posted by hand or the loop never looks
+     * at its due bit. */
+    uint8_t fired = rtc_service();
+    s_dl[id].remaining = ticks;
+    s_dl[id].period    = period;
+    s_dl[id].active    = 1;
+    s_due_mask &= (uint8_t)~(1u << id);
+    fired |= rtc_service();
+    if (fired)
+        event_post(EVT_RTC);
+
+    __bis_SR_register(gie);
+}
+
+void rtc_cancel(uint8_t id)
+{
+    if (id >= RTC_NUM_DEADLINES)
+        return;
+
+    uint16_t gie = __get_SR_register() & GIE;
+    __disable_interrupt();
+    s_dl[id].active = 0;
+    s_due_mask &= (uint8_t)~(1u << id);
+    __bis_SR_register(gie);
+}
+
+uint8_t rtc_is_due(uint8_t id)
+{
+    return (s_due_mask >> id) & 1u;
+}
+
+void rtc_clear_due(uint8_t id)
+{
+    uint16_t gie = __get_SR_register() & GIE;
+    __disable_interrupt();
+    s_due_mask &= (uint8_t)~(1u << id);
+    __bis_SR_register(gie);
+}
+
+uint32_t rtc_uptime_s(void)
+{
+    uint16_t gie = __get_SR_register() & GIE;
+    __disable_interrupt();
+    uint32_t t  = s_up_ticks + (rtc_read_counter() - s_load);
+    uint32_t up = s_up_s + t / RTC_TICKS_PER_S;
+    __bis_SR_register(gie);
+    return up;
+}
+
+uint32_t rtc_uptime_ticks(void)
+{
+    uint16_t gie = __get_SR_register() & GIE;
+    __disable_interrupt();
+    uint32_t t = s_up_s * RTC_TICKS_PER_S + s_up_ticks +
+                 (rtc_read_counter() - s_load);
+    __bis_SR_register(gie);
+    return t;
 }
 
 uint8_t rtc_measurement_due(void)
 {
-    return s_measurement_due;
+    return rtc_is_due(RTC_DL_MEASURE);
 }
 
 void rtc_clear_measurement_due(void)
 {
-    s_measurement_due = 0;
+    rtc_clear_due(RTC_DL_MEASURE);
 }
 
-/* RTC interrupt — fires once per second (RTCRDY, seconds updated).
- * Reading RTCIV clears the pending flag. Keep this short: just count and,
- * on the Nth second, raise the flag and wake the main loop.
+/* ------------------------------ timebase ------------------------------ */
+
+/* Upper 16 bits of the timebase, counted by the overflow interrupt. */
+static volatile uint16_t s_tb_hi;
+
+void timebase_init(void)
+{
+    Timer_A_initContinuousModeParam tb = {0};
+    tb.clockSource               = TIMER_A_CLOCKSOURCE_ACLK;
+    tb.clockSourceDivider        = TIMER_A_CLOCKSOURCE_DIVIDER_1;
+    tb.timerInterruptEnable_TAIE = TIMER_A_TAIE_INTERRUPT_ENABLE;
+    tb.timerClear                = TIMER_A_DO_CLEAR;
+    tb.startTimer                = true;
+
+    s_tb_hi = 0;
+    Timer_A_initContinuousMode(TIMER_A2_BASE, &tb);
+}
+
+uint32_t timebase_now(void)
+{
+    uint16_t lo, hi;
+
+    uint16_t gie = __get_SR_register() & GIE;
+    __disable_interrupt();
+
+    /* TA2R counts ACLK, asynchronous to MCLK: read until two samples
+     * agree. An overflow not yet serviced belongs to a small count. */
+    do {
+        lo = TA2R;
+    } while (lo != TA2R);
+    hi = s_tb_hi;
+    if ((TA2CTL & TAIFG) && lo < 0x8000u)
+        hi++;
+
+    __bis_SR_register(gie);
+    return ((uint32_t)hi << 16) | lo;
+}
+
+/* Timebase overflow — the only Timer_A2 interrupt; reading TA2IV clears
+ * it. Leaves the LPM bits alone: the CPU goes back to sleep. */
+#pragma vector = TIMER2_A1_VECTOR
+__interrupt void timebase_isr(void)
+{
+    switch (__even_in_range(TA2IV, TAIV__TAIFG))
+    {
+        case TAIV__TAIFG:
+            s_tb_hi++;
+            break;
+        default:
+            break;
+    }
+}
+
+/* RTC interrupt — the counter overflowed: the nearest deadline is due.
+ * Reading RTCIV clears the pending flag. Wake the main loop only if a
+ * deadline actually fired (a reschedule may have moved it).
  */
 #pragma vector = RTC_C_VECTOR
 __interrupt void rtc_c_isr(void)
 {
-    switch (__even_in_range(RTCIV, RTCIV__RTCRDYIFG))
+    switch (__even_in_range(RTCIV, RTCIV__RT1PSIFG))
     {
-        case RTCIV__RTCRDYIFG:                    /* 1 Hz tick */
-            if (++s_seconds >= MEASURE_INTERVAL_S)
+        case RTCIV__RTCTEVIFG:                    /* deadline reached */
+            if (rtc_service())
             {
-                s_seconds = 0;
-                s_measurement_due = 1;
+                event_post(EVT_RTC);
                 /* Clear the LPM bits saved on the stack so the CPU stays
                  * awake after this ISR returns (lets the main loop run). */
                 __bic_SR_register_on_exit(LPM3_bits);
             }
             break;
+        case RTCIV__RTCAIFG:                      /* calendar alarm: the
+                                                     deadline of an LPM3.5
+                                                     attempt that returned */
+            __bic_SR_register_on_exit(LPM3_bits); /* -> rtc_deep_leave() */
+            break;
         default:
             break;
     }
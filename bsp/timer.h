@@ -1,10 +1,18 @@
 /*
- * bsp/timer.h — RTC periodic wake-up (BSP layer).
+ * bsp/timer.h — tickless RTC deadline scheduler (BSP layer).
  *
- * Phase 5 scope: configure the RTC_C to fire a 1 Hz tick interrupt and,
- * every MEASURE_INTERVAL_S seconds, raise a "measurement due" flag that the
- * main loop consumes. The RTC is clocked from the LF crystal (ACLK domain),
- * so it keeps running in low-power sleep.
+ * Phase 5 scope: wake the CPU from low-power sleep only when something is
+ * due. The RTC_C (LF crystal / ACLK domain, so it keeps running in sleep)
+ * counts 128 Hz ticks; the next deadline is programmed directly, so there
+ * is no periodic tick interrupt at all. Several deadlines can be pending,
+ * each one-shot or periodic, with any interval. An expired deadline sets
+ * its "due" bit and wakes the main loop once; the main loop clears it.
+ *
+ * Deadline RTC_DL_MEASURE is the measurement cycle (MEASURE_INTERVAL_S),
+ * started by rtc_init(). Further IDs up to RTC_NUM_DEADLINES are free.
+ *
+ * The timebase below is a free-running Timer_A2 on ACLK, for measuring
+ * short intervals at ACLK resolution (the profiler, app/profile).
  *
  * (Timer_A for the bit-bang UART timebase and the encoder is added to this
  * file in later phases.)
@@ -15,19 +23,95 @@
 
 #include <stdint.h>
 
+#define RTC_TICKS_PER_S     128u                      /* ACLK / 256 */
+#define RTC_SECONDS(s)      ((uint32_t)(s) * RTC_TICKS_PER_S)
+#define RTC_MS(ms)          (((uint32_t)(ms) * RTC_TICKS_PER_S + 999u) / 1000u)
+
+/* Deadline IDs. */
+#define RTC_DL_MEASURE      0   /* periodic measurement cycle */
+#define RTC_DL_RS485_LINK   1   /* link check at a switched RS485 rate */
+#define RTC_DL_CLOCK        2   /* crystal start-up poll (clock_poll) */
+
 /*
- * rtc_init() — start the RTC_C producing a 1 Hz tick interrupt. Call after
- * clock_init() (the RTC uses the 32.768 kHz LF crystal).
+ * rtc_init() — start the RTC_C counter and schedule the periodic
+ * measurement deadline. Call after clock_init() (the RTC uses ACLK: the
+ * 32.768 kHz LF crystal once clock_poll() has switched to it, LFMODCLK
+ * until then).
  */
 void rtc_init(void);
 
+/*
+ * rtc_schedule() — (re)arm deadline `id` to expire `ticks` from now, then
+ * every `period` ticks (0 = one-shot). Clears its due bit. Safe to call
+ * with interrupts enabled.
+ */
+void rtc_schedule(uint8_t id, uint32_t ticks, uint32_t period);
+
+/* rtc_cancel() — disarm deadline `id` and clear its due bit. */
+void rtc_cancel(uint8_t id);
+
+/* rtc_is_due() — non-zero once deadline `id` has expired and until
+ * rtc_clear_due(). Set by the RTC ISR, read by main. */
+uint8_t rtc_is_due(uint8_t id);
+void    rtc_clear_due(uint8_t id);
+
+/*
+ * rtc_resume() — after a wake-up from LPM3.5, instead of rtc_init(), once
+ * ACLK runs from the LF crystal again (clock_resume). The schedule is
+ * kept in FRAM and the calendar (rtc_deep_enter) timed the sleep: this
+ * accounts for it, returns to counter mode and posts EVT_RTC if a
+ * deadline is due. Returns the ACLK cycles since the alarm (the resume
+ * time so far, saturating at 0xFFFF), or 0 if the wake-up came from
+ * somewhere else before it.
+ */
+uint16_t rtc_resume(void);
+
+/*
+ * rtc_deep_enter() — hand the schedule over for an LPM3.5 attempt:
+ * counter mode stops with the clock system, so the RTC is switched to
+ * calendar mode (LF crystal) with its alarm on the next deadline (capped
+ * at ~24 h). Returns 0, posting EVT_RTC, instead if a deadline is
+ * already due. ACLK must be on the LF crystal. Interrupts disabled.
+ *
+ * rtc_deep_leave() — take the schedule back after an attempt that
+ * returned (an ISR kept the CPU awake); posts EVT_RTC for deadlines that
+ * fell due meanwhile. Interrupts disabled.
+ */
+uint8_t rtc_deep_enter(void);
+void    rtc_deep_leave(void);
+
+/* rtc_ticks_to_next() — ticks until the nearest armed deadline (0 if one
+ * is already due, 0xFFFFFFFF if none is armed). */
+uint32_t rtc_ticks_to_next(void);
+
+/* rtc_uptime_s() — seconds since rtc_init(), from the same counter (no
+ * extra interrupts). Restarts at 0 on every reset; an LPM3.5 wake-up
+ * keeps counting. */
+uint32_t rtc_uptime_s(void);
+
+/* rtc_uptime_ticks() — rtc_uptime_s() in RTC ticks, for intervals the
+ * timebase cannot see (it is off in LPM3.5). Wraps after ~388 days. */
+uint32_t rtc_uptime_ticks(void);
+
 /*
  * rtc_measurement_due() — returns non-zero once MEASURE_INTERVAL_S seconds
- * have elapsed since the last clear. Set by the RTC ISR, read by main.
+ * have elapsed since the last measurement deadline.
  */
 uint8_t rtc_measurement_due(void);
 
 /* rtc_clear_measurement_due() — clear the flag after handling a wake-up. */
 void rtc_clear_measurement_due(void);
 
+/*
+ * timebase_init() — start Timer_A2 counting ACLK cycles from 0, extended
+ * to 32 bits by its overflow interrupt (every 2 s, which runs in a few
+ * cycles and leaves the CPU asleep). Stops in LPM3.5, so call again after
+ * the wake-up.
+ */
+void timebase_init(void);
+
+/* timebase_now() — ACLK cycles since timebase_init(), wrapping after
+ * ~36 h; differences are valid across the wrap. */
+uint32_t timebase_now(void);
+
 #endif /* BSP_TIMER_H_ */
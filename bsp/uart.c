@@ -1,34 +1,282 @@
 /*
  * bsp/uart.c — RS485 (eUSCI_A0) and HMI (eUSCI_A2) UART links.
  *
- * See bsp/uart.h. Baud generator values live in config.h; each is a matched
- * set (UCBRx / UCBRFx / UCBRSx) for its baud rate from the 8 MHz SMCLK.
+ * See bsp/uart.h. Baud generator values (UCBRx / UCBRFx / UCBRSx) are
+ * computed from SMCLK at compile time by bsp/uart_baud.h; the RS485 link
+ * has one set per rate of RS485_BAUD_TABLE and can switch between them.
+ *
+ * RS485 receive is interrupt-driven: the eUSCI_A0 RX ISR appends each byte
+ * to a ring buffer and restarts the Timer_A1 silence timer; when the timer
+ * expires (3.5 character times with no byte) the frame is committed and
+ * the CPU is woken. Bytes in between never wake the CPU. A hook set by the
+ * app layer may answer the frame from the gap ISR itself instead (the
+ * Modbus read fast path), so a poll is not held up by whatever the main
+ * loop is doing.
+ *
+ * Listen mode: after RS485_LISTEN_IDLE_MS without traffic the gap ISR
+ * holds eUSCI_A0 in reset and turns the RX pin into a falling-edge GPIO
+ * interrupt. A module in reset makes no SMCLK request, so idle sleep is
+ * true LPM3. The first start bit wakes the port ISR, which hands the pin
+ * back to the UART; that character is lost (the UART was not clocked for
+ * its start bit), and masters lead with a wake byte (config.h).
+ *
+ * Transmit is DMA-fed: the CPU writes the first byte, then each TXIFG
+ * rising edge makes a DMA channel move the next one into TXBUF. The CPU is
+ * free (or asleep in LPM0) for the whole frame. On RS485 the DMA-done
+ * interrupt arms the eUSCI transmit-complete interrupt, which releases the
+ * direction pin only once the last stop bit is on the wire.
  */
 
 #include <msp430.h>
 #include "driverlib/MSP430FR5xx_6xx/driverlib.h"
 #include "config.h"
+#include "bsp/event.h"
 #include "bsp/uart.h"
+#include "bsp/uart_baud.h"
+
+/* Transfer-in-progress flags, cleared by the completion ISRs. */
+static volatile uint8_t s_rs485_tx_busy;
+static volatile uint8_t s_hmi_tx_busy;
+
+/* Set while the main loop sleeps for the RS485 transmitter; only then does
+ * the transmit-complete ISR leave LPM. A fast-path reply that ends while
+ * the main loop idles must not wake it. */
+static volatile uint8_t s_rs485_tx_waiting;
+
+/* Shared helper: set up a DMA channel to feed the given eUSCI_A's TXBUF
+ * one byte per trigger, with its completion interrupt enabled. */
+static void uart_dma_init(uint8_t channel, uint8_t trigger, uint16_t base)
+{
+    DMA_initParam p = {0};
+    p.channelSelect       = channel;
+    p.transferModeSelect  = DMA_TRANSFER_SINGLE;
+    p.transferSize        = 0;
+    p.triggerSourceSelect = trigger;
+    p.transferUnitSelect  = DMA_SIZE_SRCBYTE_DSTBYTE;
+    p.triggerTypeSelect   = DMA_TRIGGER_RISINGEDGE;
+    DMA_init(&p);
+
+    DMA_setDstAddress(channel, (uint32_t)(base + OFS_UCAxTXBUF),
+                      DMA_DIRECTION_UNCHANGED);
+    DMA_clearInterrupt(channel);
+    DMA_enableInterrupt(channel);
+}
+
+/* Shared helper: start a transfer of len >= 2 bytes. TXIFG is already set
+ * while the UART is idle, so it would never produce the rising edge the
+ * DMA triggers on; writing the first byte by hand clears it, and it rises
+ * again as that byte moves into the shift register. */
+static void uart_dma_start(uint8_t channel, uint16_t base,
+                           const uint8_t *data, uint16_t len)
+{
+    DMA_setSrcAddress(channel, (uint32_t)(uintptr_t)(data + 1),
+                      DMA_DIRECTION_INCREMENT);
+    DMA_setTransferSize(channel, (uint16_t)(len - 1));
+    DMA_enableTransfers(channel);
 
-/* Shared helper: block until the given eUSCI_A can accept a byte, then
- * write it. */
-static void uart_put(uint16_t base, uint8_t b)
+    EUSCI_A_UART_transmitData(base, data[0]);
+}
+
+/* Shared helper: sleep in LPM0 (SMCLK stays on for the UART and the DMA)
+ * until *busy is cleared. Race-free check-then-sleep; leaves GIE set. */
+static void uart_wait_done(volatile uint8_t *busy)
 {
-    while (!EUSCI_A_UART_getInterruptStatus(
-                base, EUSCI_A_UART_TRANSMIT_INTERRUPT_FLAG))
-        ;
-    EUSCI_A_UART_transmitData(base, b);
+    for (;;)
+    {
+        __disable_interrupt();
+        if (!*busy)
+        {
+            __enable_interrupt();
+            return;
+        }
+        __bis_SR_register(LPM0_bits | GIE);
+    }
 }
 
-/* Shared helper: wait until the last byte has fully left the shift register. */
-static void uart_wait_idle(uint16_t base)
+/* Shared helper: as uart_wait_done(), then set *busy before interrupts
+ * come back on, so no ISR can start a transfer in between. */
+static void uart_claim(volatile uint8_t *busy)
 {
-    while (EUSCI_A_UART_queryStatusFlags(base, EUSCI_A_UART_BUSY))
-        ;
+    for (;;)
+    {
+        __disable_interrupt();
+        if (!*busy)
+        {
+            *busy = 1;
+            __enable_interrupt();
+            return;
+        }
+        __bis_SR_register(LPM0_bits | GIE);
+    }
 }
 
 /* ===================== RS485 — eUSCI_A0 ============================== */
 
+#if (RS485_RX_BUF_SIZE & (RS485_RX_BUF_SIZE - 1)) || RS485_RX_BUF_SIZE > 128
+#error "RS485_RX_BUF_SIZE must be a power of two <= 128"
+#endif
+#if (RS485_RX_MAX_FRAMES & (RS485_RX_MAX_FRAMES - 1))
+#error "RS485_RX_MAX_FRAMES must be a power of two"
+#endif
+
+#define RX_BUF_MASK     (RS485_RX_BUF_SIZE - 1)
+#define RX_QUEUE_MASK   (RS485_RX_MAX_FRAMES - 1)
+
+/* Receive ring buffer. Indices are free-running uint8_t, masked on access,
+ * so head - tail is the fill level. The ISRs own the head side, the main
+ * loop the tail side. Only committed frames are ever read, so the gap ISR
+ * may rewind s_rx_head to throw away a bad frame in progress.
+ */
+static uint8_t          s_rx_buf[RS485_RX_BUF_SIZE];
+static volatile uint8_t s_rx_head;          /* next byte written (ISR)     */
+static volatile uint8_t s_rx_tail;          /* next byte read (main)       */
+static uint8_t          s_rx_frame_start;   /* first byte of frame (ISR)   */
+static uint8_t          s_rx_overflow;      /* frame in progress is lost   */
+
+/* Lengths of committed frames, oldest first. */
+static volatile uint8_t s_rx_len_q[RS485_RX_MAX_FRAMES];
+static volatile uint8_t s_rx_q_head;        /* next slot written (ISR)     */
+static volatile uint8_t s_rx_q_tail;        /* next slot read (main)       */
+
+/* One selectable rate: baud generator set, frame-gap timeout, and the
+ * number of silent gaps that make up RS485_LISTEN_IDLE_MS. */
+typedef struct {
+    uint32_t baud;
+    uint16_t br;        /* UCBRx                 */
+    uint8_t  brf;       /* UCBRFx                */
+    uint8_t  brs;       /* UCBRSx                */
+    uint16_t gap;       /* Timer_A1 CCR0, ACLK   */
+    uint16_t idle_gaps; /* gaps before listening */
+} rs485_rate_t;
+
+#define RS485_LISTEN_GAPS(b) \
+    (uint16_t)((RS485_LISTEN_IDLE_MS * CONFIG_ACLK_FREQ_HZ / 1000UL + \
+                RS485_FRAME_GAP_TICKS(b) - 1) / RS485_FRAME_GAP_TICKS(b))
+
+#define RS485_RATE(b) \
+    { (b), UART_BR_PRESCALAR(CONFIG_SMCLK_FREQ_HZ, b), \
+      UART_BR_FIRSTMOD(CONFIG_SMCLK_FREQ_HZ, b), \
+      UART_BR_SECONDMOD(CONFIG_SMCLK_FREQ_HZ, b), RS485_FRAME_GAP_TICKS(b), \
+      RS485_LISTEN_GAPS(b) },
+
+static const rs485_rate_t s_rs485_rates[] = { RS485_BAUD_TABLE(RS485_RATE) };
+
+/* Compile-time checks, one per rate: oversampling needs N >= 16, the
+ * mean rate error must stay within UART_BAUD_MAX_ERR_PPM, and the wake
+ * byte must end up in a fragment of its own (lead time > frame gap). */
+#define RS485_RATE_CHECK(b) \
+    typedef char rs485_baud_unusable_##b[ \
+        (CONFIG_SMCLK_FREQ_HZ / (b) >= 16UL && \
+         UART_BAUD_ERR_PPM(CONFIG_SMCLK_FREQ_HZ, b) <= UART_BAUD_MAX_ERR_PPM && \
+         RS485_WAKE_LEAD_MS * CONFIG_ACLK_FREQ_HZ / 1000UL > \
+             RS485_FRAME_GAP_TICKS(b)) \
+        ? 1 : -1];
+RS485_BAUD_TABLE(RS485_RATE_CHECK)
+
+#define RS485_IS_DEFAULT(b)     ((b) == RS485_BAUD) ||
+#if !(RS485_BAUD_TABLE(RS485_IS_DEFAULT) 0)
+#error "RS485_BAUD must be one of RS485_BAUD_TABLE"
+#endif
+
+#define RS485_NUM_RATES (sizeof s_rs485_rates / sizeof s_rs485_rates[0])
+
+static const rs485_rate_t *s_rs485_rate;    /* the one in use */
+
+static const rs485_rate_t *rs485_find_rate(uint32_t baud)
+{
+    uint8_t i;
+    for (i = 0; i < RS485_NUM_RATES; i++)
+    {
+        if (s_rs485_rates[i].baud == baud)
+            return &s_rs485_rates[i];
+    }
+    return 0;
+}
+
+/* (Re)program eUSCI_A0 for rate r. The module is held in reset meanwhile,
+ * which also clears its interrupt enables: the RX one is set again here. */
+static void rs485_uart_config(const rs485_rate_t *r)
+{
+    EUSCI_A_UART_initParam param = {0};
+    param.selectClockSource   = EUSCI_A_UART_CLOCKSOURCE_SMCLK;
+    param.clockPrescalar      = r->br;
+    param.firstModReg         = r->brf;
+    param.secondModReg        = r->brs;
+    param.parity              = EUSCI_A_UART_NO_PARITY;
+    param.msborLsbFirst       = EUSCI_A_UART_LSB_FIRST;
+    param.numberofStopBits    = EUSCI_A_UART_ONE_STOP_BIT;
+    param.uartMode            = EUSCI_A_UART_MODE;
+    param.overSampling        = EUSCI_A_UART_OVERSAMPLING_BAUDRATE_GENERATION;
+
+    EUSCI_A_UART_init(EUSCI_A0_BASE, &param);
+    EUSCI_A_UART_enable(EUSCI_A0_BASE);
+
+    EUSCI_A_UART_clearInterrupt(EUSCI_A0_BASE,
+                                EUSCI_A_UART_RECEIVE_INTERRUPT_FLAG);
+    EUSCI_A_UART_enableInterrupt(EUSCI_A0_BASE, EUSCI_A_UART_RECEIVE_INTERRUPT);
+
+    s_rs485_rate = r;
+}
+
+/* Timer_A1 control word with the silence timer running / stopped. */
+#define GAP_TIMER_RUN   (TASSEL__ACLK | MC__UP | TACLR)
+#define GAP_TIMER_STOP  (TASSEL__ACLK | MC__STOP)
+
+/* Listen mode. The RX pin is switched by raw port 4 registers (the ISRs
+ * need them anyway); the primary module function is SEL1:SEL0 = 0:1. */
+#if RS485_RX_PORT != GPIO_PORT_P4
+#error "RS485 listen mode expects the RX pin on port 4 (PORT4_VECTOR)"
+#endif
+#if RS485_LISTEN_IDLE_MS * CONFIG_ACLK_FREQ_HZ / 1000UL > 65535UL
+#error "RS485_LISTEN_IDLE_MS too long for the idle gap counter"
+#endif
+
+static volatile uint8_t s_rs485_listen;     /* UART in reset, pin is GPIO  */
+static uint16_t         s_rx_idle_gaps;     /* silent gaps so far (ISR)    */
+
+/* Hand the RX pin to the port interrupt and hold the UART in reset. Call
+ * with interrupts disabled, the link idle. Setting UCSWRST clears the
+ * module's interrupt enables and flags. If the line is already low, a
+ * start bit has begun: the pending edge flag wakes us again at once. */
+static void rs485_listen_enter(void)
+{
+    TA1CTL     = GAP_TIMER_STOP;
+    UCA0CTLW0 |= UCSWRST;
+
+    P4SEL0 &= ~RS485_RX_PIN;
+    P4SEL1 &= ~RS485_RX_PIN;
+    P4IES  |= RS485_RX_PIN;                 /* falling edge = start bit    */
+    P4IFG  &= ~RS485_RX_PIN;
+    if (!(P4IN & RS485_RX_PIN))
+        P4IFG |= RS485_RX_PIN;
+    P4IE   |= RS485_RX_PIN;
+
+    s_rs485_listen = 1;
+}
+
+/* Give the pin back to the UART, release it, and start the silence timer
+ * so the link falls back to listen mode once it goes quiet again. Call
+ * with interrupts disabled. */
+static void rs485_listen_exit(void)
+{
+    P4IE   &= ~RS485_RX_PIN;
+    P4SEL0 |= RS485_RX_PIN;
+
+    UCA0CTLW0 &= ~UCSWRST;
+    UCA0IE    |= UCRXIE;
+
+    s_rs485_listen = 0;
+    s_rx_idle_gaps = 0;
+    TA1CTL = GAP_TIMER_RUN;
+}
+
+/* Fast-path hook (see uart_rs485_set_rx_hook()) and its buffers: the
+ * frame copied out of the ring in one piece, and the reply, which the DMA
+ * reads from until the transfer is done. */
+static uart_rs485_rx_hook_t s_rx_hook;
+static uint8_t              s_fast_req[RS485_MAX_FRAME];
+static uint8_t              s_fast_resp[RS485_MAX_FRAME];
+
 void uart_rs485_init(void)
 {
     /* Direction-enable pin: output, start in RX (listen) mode. */
@@ -41,35 +289,141 @@ void uart_rs485_init(void)
     GPIO_setAsPeripheralModuleFunctionInputPin(
         RS485_RX_PORT, RS485_RX_PIN, GPIO_PRIMARY_MODULE_FUNCTION);
 
-    EUSCI_A_UART_initParam param = {0};
-    param.selectClockSource   = EUSCI_A_UART_CLOCKSOURCE_SMCLK;
-    param.clockPrescalar      = RS485_BR_PRESCALAR;
-    param.firstModReg         = RS485_BR_FIRSTMOD;
-    param.secondModReg        = RS485_BR_SECONDMOD;
-    param.parity              = EUSCI_A_UART_NO_PARITY;
-    param.msborLsbFirst       = EUSCI_A_UART_LSB_FIRST;
-    param.numberofStopBits    = EUSCI_A_UART_ONE_STOP_BIT;
-    param.uartMode            = EUSCI_A_UART_MODE;
-    param.overSampling        = EUSCI_A_UART_OVERSAMPLING_BAUDRATE_GENERATION;
+    /* Frame-gap timer: Timer_A1 up mode on ACLK, CCR0 = 3.5 char times.
+     * The RX ISR restarts it on every byte; once idle it keeps running
+     * to time RS485_LISTEN_IDLE_MS, then stops in listen mode. */
+    Timer_A_initUpModeParam gap = {0};
+    gap.clockSource                 = TIMER_A_CLOCKSOURCE_ACLK;
+    gap.clockSourceDivider          = TIMER_A_CLOCKSOURCE_DIVIDER_1;
+    gap.timerPeriod                 = RS485_FRAME_GAP_TICKS(RS485_BAUD);
+    gap.timerInterruptEnable_TAIE   = TIMER_A_TAIE_INTERRUPT_DISABLE;
+    gap.captureCompareInterruptEnable_CCR0_CCIE =
+        TIMER_A_CCIE_CCR0_INTERRUPT_ENABLE;
+    gap.timerClear                  = TIMER_A_DO_CLEAR;
+    gap.startTimer                  = true;
+    Timer_A_initUpMode(TIMER_A1_BASE, &gap);
 
-    EUSCI_A_UART_init(EUSCI_A0_BASE, &param);
-    EUSCI_A_UART_enable(EUSCI_A0_BASE);
+    s_rx_head = s_rx_tail = s_rx_frame_start = 0;
+    s_rx_q_head = s_rx_q_tail = 0;
+    s_rx_overflow = 0;
+    s_rx_hook = 0;
+    s_rx_idle_gaps = 0;
+    s_rs485_listen = 0;
+
+    uart_dma_init(RS485_TX_DMA_CHANNEL, RS485_TX_DMA_TRIGGER, EUSCI_A0_BASE);
+    s_rs485_tx_busy = 0;
+    s_rs485_tx_waiting = 0;
+
+    rs485_uart_config(rs485_find_rate(RS485_BAUD));
 }
 
-void uart_rs485_send(const uint8_t *data, uint16_t len)
+/* uart_claim() on the RS485 transmitter, woken by transmit-complete. */
+static void rs485_claim(void)
+{
+    s_rs485_tx_waiting = 1;
+    uart_claim(&s_rs485_tx_busy);
+    s_rs485_tx_waiting = 0;
+}
+
+uint8_t uart_rs485_set_baud(uint32_t baud)
+{
+    const rs485_rate_t *r = rs485_find_rate(baud);
+    if (r == 0)
+        return 0;
+
+    /* Let a reply in flight finish at the old rate, and keep the gap ISR
+     * from starting one while the module is reset. */
+    rs485_claim();
+
+    __disable_interrupt();
+    if (s_rs485_listen)
+        rs485_listen_exit();
+    /* A frame half received at the old rate is garbage at the new one. */
+    TA1CTL    = GAP_TIMER_STOP;
+    s_rx_head = s_rx_frame_start;
+    s_rx_overflow = 0;
+    TA1CCR0   = r->gap;
+    rs485_uart_config(r);
+    s_rx_idle_gaps = 0;
+    TA1CTL    = GAP_TIMER_RUN;
+    s_rs485_tx_busy = 0;
+    __enable_interrupt();
+
+    return 1;
+}
+
+uint32_t uart_rs485_get_baud(void)
+{
+    return s_rs485_rate->baud;
+}
+
+/* Start a transfer of len >= 1 bytes; s_rs485_tx_busy is already set. */
+static void rs485_tx_start(const uint8_t *data, uint16_t len)
 {
     /* Drive the bus. */
     GPIO_setOutputHighOnPin(RS485_EN_PORT, RS485_EN_PIN);
 
-    uint16_t i;
-    for (i = 0; i < len; i++)
-        uart_put(EUSCI_A0_BASE, data[i]);
+    /* A stale transmit-complete flag from an earlier byte would release
+     * the bus at once when the interrupt is armed. */
+    EUSCI_A_UART_clearInterrupt(EUSCI_A0_BASE,
+                                EUSCI_A_UART_TRANSMIT_COMPLETE_INTERRUPT_FLAG);
 
-    /* Releasing the bus before the last byte is out would truncate it. */
-    uart_wait_idle(EUSCI_A0_BASE);
+    if (len == 1)
+    {
+        /* Nothing for the DMA to do: arm transmit-complete directly. */
+        EUSCI_A_UART_transmitData(EUSCI_A0_BASE, data[0]);
+        EUSCI_A_UART_enableInterrupt(EUSCI_A0_BASE,
+                                     EUSCI_A_UART_TRANSMIT_COMPLETE_INTERRUPT);
+        return;
+    }
 
-    /* Back to listening. */
-    GPIO_setOutputLowOnPin(RS485_EN_PORT, RS485_EN_PIN);
+    uart_dma_start(RS485_TX_DMA_CHANNEL, EUSCI_A0_BASE, data, len);
+}
+
+void uart_rs485_send_async(const uint8_t *data, uint16_t len)
+{
+    if (len == 0)
+        return;
+
+    /* One transfer at a time; the gap ISR may start a fast-path reply
+     * whenever the link is idle, so claim it atomically. Once claimed the
+     * gap ISR will not enter listen mode, but it may already be in it. */
+    rs485_claim();
+
+    __disable_interrupt();
+    if (s_rs485_listen)
+        rs485_listen_exit();
+    __enable_interrupt();
+
+    rs485_tx_start(data, len);
+}
+
+void uart_rs485_set_rx_hook(uart_rs485_rx_hook_t hook)
+{
+    s_rx_hook = hook;
+}
+
+uint8_t uart_rs485_tx_busy(void)
+{
+    return s_rs485_tx_busy;
+}
+
+uint8_t uart_rs485_listening(void)
+{
+    return s_rs485_listen;
+}
+
+void uart_rs485_wait_tx(void)
+{
+    s_rs485_tx_waiting = 1;
+    uart_wait_done(&s_rs485_tx_busy);
+    s_rs485_tx_waiting = 0;
+}
+
+void uart_rs485_send(const uint8_t *data, uint16_t len)
+{
+    uart_rs485_send_async(data, len);
+    uart_rs485_wait_tx();
 }
 
 void uart_rs485_send_string(const char *str)
@@ -80,8 +434,190 @@ void uart_rs485_send_string(const char *str)
     uart_rs485_send((const uint8_t *)str, len);
 }
 
+uint8_t uart_rs485_frame_ready(void)
+{
+    return (s_rx_q_head != s_rx_q_tail) ? 1u : 0u;
+}
+
+uint8_t uart_rs485_read_frame(uint8_t *buf)
+{
+    if (s_rx_q_head == s_rx_q_tail)
+        return 0;
+
+    uint8_t len  = s_rx_len_q[s_rx_q_tail & RX_QUEUE_MASK];
+    uint8_t tail = s_rx_tail;
+
+    uint8_t i;
+    for (i = 0; i < len; i++)
+        buf[i] = s_rx_buf[(uint8_t)(tail + i) & RX_BUF_MASK];
+
+    /* Release the bytes first, then the queue slot: the ISR never sees a
+     * free slot whose bytes are still counted as used. */
+    s_rx_tail = (uint8_t)(tail + len);
+    s_rx_q_tail++;
+
+    return len;
+}
+
+/* eUSCI_A0 interrupt.
+ * RX: one received byte. Store it and restart the silence timer; do NOT
+ * wake the CPU (the gap timer does that once per frame). Reading UCA0RXBUF
+ * clears UCRXIFG.
+ * TXCPT: armed by the DMA ISR at the end of a transmit. Wakes the CPU only
+ * if the main loop is waiting for the transmitter.
+ */
+#pragma vector = USCI_A0_VECTOR
+__interrupt void usci_a0_isr(void)
+{
+    switch (__even_in_range(UCA0IV, USCI_UART_UCTXCPTIFG))
+    {
+        case USCI_UART_UCRXIFG:
+        {
+            uint8_t b = UCA0RXBUF;
+
+            TA1CTL = GAP_TIMER_RUN;      /* frame ends 3.5 chars from now */
+
+            /* Longer than any valid frame, or no room left: drop the whole
+             * frame (committing a truncated one would only fail its CRC). */
+            if ((uint8_t)(s_rx_head - s_rx_frame_start) >= RS485_MAX_FRAME ||
+                (uint8_t)(s_rx_head - s_rx_tail) >= RS485_RX_BUF_SIZE)
+                s_rx_overflow = 1;
+
+            if (!s_rx_overflow)
+            {
+                s_rx_buf[s_rx_head & RX_BUF_MASK] = b;
+                s_rx_head++;
+            }
+            break;
+        }
+        case USCI_UART_UCTXCPTIFG:
+            /* Last stop bit is out: now it is safe to release the bus.
+             * The listen-mode idle time counts from here. */
+            UCA0IE &= ~UCTXCPTIE;
+            GPIO_setOutputLowOnPin(RS485_EN_PORT, RS485_EN_PIN);
+            s_rs485_tx_busy = 0;
+            s_rx_idle_gaps  = 0;
+            if (s_rs485_tx_waiting)
+                __bic_SR_register_on_exit(LPM3_bits);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Offer the frame just received (the last `len` bytes of the ring) to the
+ * fast-path hook, and start its reply if it has one. Only while the link
+ * is idle and no earlier frame waits for the main loop, so replies keep
+ * request order. Returns 1 if the frame was answered. Gap ISR only. */
+static uint8_t rs485_fast_path(uint8_t len)
+{
+    uint8_t i, n;
+
+    if (s_rx_hook == 0 || s_rs485_tx_busy || s_rx_q_head != s_rx_q_tail)
+        return 0;
+
+    for (i = 0; i < len; i++)
+        s_fast_req[i] = s_rx_buf[(uint8_t)(s_rx_frame_start + i) & RX_BUF_MASK];
+
+    n = s_rx_hook(s_fast_req, len, s_fast_resp);
+    if (n == 0)
+        return 0;
+
+    s_rs485_tx_busy = 1;
+    rs485_tx_start(s_fast_resp, n);
+    return 1;
+}
+
+/* Timer_A1 CCR0 interrupt — 3.5 character times of silence: the frame in
+ * progress is complete. Answer it on the fast path, or commit it and wake
+ * the main loop. With no frame in progress it counts the idle gaps
+ * instead, and enters listen mode after RS485_LISTEN_IDLE_MS of them
+ * (never while a reply is going out). The CCR0 vector is dedicated, so
+ * its flag clears automatically on entry.
+ */
+#pragma vector = TIMER1_A0_VECTOR
+__interrupt void rs485_frame_gap_isr(void)
+{
+    uint8_t len = (uint8_t)(s_rx_head - s_rx_frame_start);
+
+    if (len == 0 && !s_rx_overflow)
+    {
+        if (s_rs485_tx_busy)
+            s_rx_idle_gaps = 0;
+        else if (++s_rx_idle_gaps >= s_rs485_rate->idle_gaps)
+            rs485_listen_enter();
+        return;
+    }
+    s_rx_idle_gaps = 0;
+
+    /* Shorter than addr + func + CRC, overflowed, or no free queue slot:
+     * discard the bytes by rewinding the head. */
+    if (s_rx_overflow || len < 4 ||
+        (uint8_t)(s_rx_q_head - s_rx_q_tail) >= RS485_RX_MAX_FRAMES)
+    {
+        s_rx_head = s_rx_frame_start;
+    }
+    else if (rs485_fast_path(len))
+    {
+        /* Answered from here: the request is consumed, the main loop is
+         * not woken. */
+        s_rx_head = s_rx_frame_start;
+    }
+    else
+    {
+        s_rx_len_q[s_rx_q_head & RX_QUEUE_MASK] = len;
+        s_rx_q_head++;
+        s_rx_frame_start = s_rx_head;
+
+        /* Stay awake after this ISR so the main loop sees the frame. */
+        event_post(EVT_RS485_RX);
+        __bic_SR_register_on_exit(LPM3_bits);
+    }
+
+    s_rx_overflow = 0;
+}
+
+/* Port 4 interrupt — listen mode only: a falling edge on the RX pin, the
+ * start bit of the first character after a quiet spell. Hand the pin back
+ * to the UART for the rest of the traffic. There is no event until the
+ * frame is complete, but the CPU is woken anyway: the main loop may have
+ * been on its way into LPM3.5, which must not happen with the UART on.
+ * Reading P4IV clears the flag.
+ */
+#pragma vector = PORT4_VECTOR
+__interrupt void port4_isr(void)
+{
+    if (__even_in_range(P4IV, P4IV__P4IFG7) != P4IV__NONE && s_rs485_listen)
+    {
+        rs485_listen_exit();
+        __bic_SR_register_on_exit(LPM3_bits);
+    }
+}
+
 /* ===================== HMI screen — eUSCI_A2 ========================= */
 
+#if (HMI_RX_BUF_SIZE & (HMI_RX_BUF_SIZE - 1)) || HMI_RX_BUF_SIZE > 128
+#error "HMI_RX_BUF_SIZE must be a power of two <= 128"
+#endif
+
+#if CONFIG_SMCLK_FREQ_HZ / HMI_BAUD < 16 || \
+    UART_BAUD_ERR_PPM(CONFIG_SMCLK_FREQ_HZ, HMI_BAUD) > UART_BAUD_MAX_ERR_PPM
+#error "HMI_BAUD cannot be generated from SMCLK accurately enough"
+#endif
+
+#define HMI_RX_MASK     (HMI_RX_BUF_SIZE - 1)
+
+#define HMI_BR_PRESCALAR  UART_BR_PRESCALAR(CONFIG_SMCLK_FREQ_HZ, HMI_BAUD)
+#define HMI_BR_FIRSTMOD   UART_BR_FIRSTMOD(CONFIG_SMCLK_FREQ_HZ, HMI_BAUD)
+#define HMI_BR_SECONDMOD  UART_BR_SECONDMOD(CONFIG_SMCLK_FREQ_HZ, HMI_BAUD)
+
+/* HMI receive ring, same free-running index scheme as the RS485 one. The
+ * screen's replies and touch events are not framed by silence, so bytes
+ * are handed over as a plain stream. */
+static uint8_t          s_hmi_rx_buf[HMI_RX_BUF_SIZE];
+static volatile uint8_t s_hmi_rx_head;      /* next byte written (ISR)     */
+static volatile uint8_t s_hmi_rx_tail;      /* next byte read (main)       */
+
 void uart_hmi_init(void)
 {
     /* UCA2TXD / UCA2RXD are the primary module function on P7.0/P7.1
@@ -104,13 +640,112 @@ void uart_hmi_init(void)
 
     EUSCI_A_UART_init(EUSCI_A2_BASE, &param);
     EUSCI_A_UART_enable(EUSCI_A2_BASE);
+
+    uart_dma_init(HMI_TX_DMA_CHANNEL, HMI_TX_DMA_TRIGGER, EUSCI_A2_BASE);
+    s_hmi_tx_busy = 0;
+
+    s_hmi_rx_head = 0;
+    s_hmi_rx_tail = 0;
+    EUSCI_A_UART_clearInterrupt(EUSCI_A2_BASE,
+                                EUSCI_A_UART_RECEIVE_INTERRUPT_FLAG);
+    EUSCI_A_UART_enableInterrupt(EUSCI_A2_BASE,
+                                 EUSCI_A_UART_RECEIVE_INTERRUPT);
+}
+
+uint8_t uart_hmi_read(uint8_t *buf, uint8_t max)
+{
+    uint8_t n = 0;
+
+    while (n < max && s_hmi_rx_tail != s_hmi_rx_head)
+    {
+        buf[n++] = s_hmi_rx_buf[s_hmi_rx_tail & HMI_RX_MASK];
+        s_hmi_rx_tail++;
+    }
+    return n;
+}
+
+void uart_hmi_send_async(const uint8_t *data, uint16_t len)
+{
+    if (len == 0)
+        return;
+
+    uart_hmi_wait_tx();
+
+    if (len == 1)
+    {
+        EUSCI_A_UART_transmitData(EUSCI_A2_BASE, data[0]);
+        return;
+    }
+
+    s_hmi_tx_busy = 1;
+    uart_dma_start(HMI_TX_DMA_CHANNEL, EUSCI_A2_BASE, data, len);
+}
+
+void uart_hmi_wait_tx(void)
+{
+    uart_wait_done(&s_hmi_tx_busy);
 }
 
 void uart_hmi_send(const uint8_t *data, uint16_t len)
 {
-    uint16_t i;
-    for (i = 0; i < len; i++)
-        uart_put(EUSCI_A2_BASE, data[i]);
+    uart_hmi_send_async(data, len);
+    uart_hmi_wait_tx();
+}
+
+/* eUSCI_A2 interrupt — one byte from the screen. Only the first byte into
+ * an empty ring posts EVT_HMI_RX and wakes the CPU; the rest of the burst
+ * is picked up by the same uart_hmi_read() drain. A full ring drops the
+ * byte. Reading UCA2RXBUF clears UCRXIFG.
+ */
+#pragma vector = USCI_A2_VECTOR
+__interrupt void usci_a2_isr(void)
+{
+    switch (__even_in_range(UCA2IV, USCI_UART_UCTXCPTIFG))
+    {
+        case USCI_UART_UCRXIFG:
+        {
+            uint8_t b    = UCA2RXBUF;
+            uint8_t used = (uint8_t)(s_hmi_rx_head - s_hmi_rx_tail);
+
+            if (used < HMI_RX_BUF_SIZE)
+            {
+                s_hmi_rx_buf[s_hmi_rx_head & HMI_RX_MASK] = b;
+                s_hmi_rx_head++;
+            }
+            if (used == 0)
+            {
+                event_post(EVT_HMI_RX);
+                __bic_SR_register_on_exit(LPM3_bits);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/* ===================== DMA completion ================================ */
+
+/* DMA interrupt — a TX channel has moved its last byte into TXBUF. The
+ * flags are checked per channel (not via DMAIV) so the channel numbers
+ * can stay in config.h.
+ */
+#pragma vector = DMA_VECTOR
+__interrupt void dma_isr(void)
+{
+    if (DMA_getInterruptStatus(RS485_TX_DMA_CHANNEL))
+    {
+        DMA_clearInterrupt(RS485_TX_DMA_CHANNEL);
+        /* The last byte is still in TXBUF / the shift register; the
+         * transmit-complete interrupt finishes the job. */
+        UCA0IE |= UCTXCPTIE;
+    }
 
-    uart_wait_idle(EUSCI_A2_BASE);
+    if (DMA_getInterruptStatus(HMI_TX_DMA_CHANNEL))
+    {
+        DMA_clearInterrupt(HMI_TX_DMA_CHANNEL);
+        /* No direction pin on the HMI link: the buffer is free now. */
+        s_hmi_tx_busy = 0;
+        __bic_SR_register_on_exit(LPM3_bits);
+    }
 }
@@ -1,13 +1,29 @@
 /*
  * bsp/uart.h — the board's two UART links (BSP layer).
  *
- *   RS485  : eUSCI_A0 on P4.3/P4.4, 9600 8N1, half-duplex (DIR pin on P4.5)
+ *   RS485  : eUSCI_A0 on P4.3/P4.4, 9600 8N1 (switchable up to 115200),
+ *            half-duplex (DIR pin on P4.5)
  *            -> to the LoRaWAN gateway / center.
  *   HMI    : eUSCI_A2 on P7.0/P7.1, 115200 8N1, full-duplex 3.3 V TTL
  *            -> to the TY040HDL04NF screen module (see CLAUDE.md §2.2).
  *
  * RS485 send handles the transceiver direction pin; the HMI link is a plain
  * point-to-point TTL line and needs no direction control.
+ *
+ * Both links transmit by DMA, so a send can run while the CPU works or
+ * sleeps in LPM0; the blocking send functions are thin wrappers.
+ *
+ * RS485 receive runs in the background: bytes are buffered by the RX ISR
+ * and grouped into frames by the Modbus 3.5-character silence rule
+ * (Timer_A1 on ACLK). The CPU is woken once per complete frame, unless
+ * the fast-path hook answers it from the ISR. After RS485_LISTEN_IDLE_MS
+ * of silence the link drops into listen mode (UART in reset, RX pin as an
+ * edge interrupt) so the device can sleep in LPM3; the next start bit or
+ * send wakes it, and the first character after a quiet spell is lost
+ * (see the wake byte in config.h). HMI receive is a plain byte stream,
+ * buffered by its own RX ISR.
+ *
+ * Both receive paths post a bsp/event bit when there is data to read.
  */
 
 #ifndef BSP_UART_H_
@@ -17,23 +33,84 @@
 
 /* --- RS485 (eUSCI_A0) ------------------------------------------------ */
 
-/* Configure eUSCI_A0 for 9600 8N1 and put the transceiver in receive mode.
- * Call after clock_init() (needs SMCLK). */
+/* Configure eUSCI_A0 for RS485_BAUD 8N1, put the transceiver in receive
+ * mode and start the interrupt-driven receive path. Call after
+ * clock_init() (needs SMCLK and ACLK). */
 void uart_rs485_init(void);
 
-/* Send raw bytes over RS485 (binary-safe), driving the direction pin high
- * for the transfer and back low when the last byte has shifted out. */
+/* Switch the link to `baud`, one of RS485_BAUD_TABLE (config.h). Waits
+ * for a transfer in flight to finish at the old rate; a frame being
+ * received is dropped. Returns 0 (and changes nothing) for a rate not in
+ * the table. */
+uint8_t uart_rs485_set_baud(uint32_t baud);
+
+/* The rate the link runs at now. */
+uint32_t uart_rs485_get_baud(void);
+
+/* Start sending raw bytes over RS485 (binary-safe) by DMA and return at
+ * once. The direction pin goes high now and back low from the transmit-
+ * complete interrupt once the last byte has shifted out. `data` must stay
+ * untouched until uart_rs485_tx_busy() reads 0. Waits for a previous
+ * transfer first. */
+void uart_rs485_send_async(const uint8_t *data, uint16_t len);
+
+/* Non-zero while an RS485 transfer is still going (bus driven). */
+uint8_t uart_rs485_tx_busy(void);
+
+/* Non-zero while the RS485 link is in listen mode: idle, UART in reset,
+ * and only the RX pin's edge interrupt (which also works from LPM3.5)
+ * watching the bus. */
+uint8_t uart_rs485_listening(void);
+
+/* Sleep in LPM0 until the current RS485 transfer has finished. Only a
+ * sleeper here (or in a send waiting for the link) is woken when a
+ * transfer ends; polling uart_rs485_tx_busy() from event_wait() is not. */
+void uart_rs485_wait_tx(void);
+
+/* Blocking send: uart_rs485_send_async() + uart_rs485_wait_tx(). */
 void uart_rs485_send(const uint8_t *data, uint16_t len);
 
 /* Send a NUL-terminated string over RS485 (debug convenience). */
 void uart_rs485_send_string(const char *str);
 
+/* Returns non-zero if at least one complete received frame is queued. */
+uint8_t uart_rs485_frame_ready(void);
+
+/* Copy the oldest complete frame into `buf` (must hold RS485_MAX_FRAME
+ * bytes) and release it. Returns the frame length including its CRC, or 0
+ * if no frame is queued. The CRC is NOT checked here (see drivers/rs485). */
+uint8_t uart_rs485_read_frame(uint8_t *buf);
+
+/* Fast-path hook: called from the frame-gap ISR with each complete frame
+ * (`frame`, `len` including the CRC) while the link is idle and no other
+ * frame is queued. Returns the length of a reply written into `resp`
+ * (RS485_MAX_FRAME bytes), which is sent at once by DMA and the request
+ * dropped; 0 leaves the frame to the main loop as usual. Runs in
+ * interrupt context, so it must be short and must not block. */
+typedef uint8_t (*uart_rs485_rx_hook_t)(const uint8_t *frame, uint8_t len,
+                                        uint8_t *resp);
+
+/* Install (or, with 0, remove) the fast-path hook. */
+void uart_rs485_set_rx_hook(uart_rs485_rx_hook_t hook);
+
 /* --- HMI screen (eUSCI_A2) ------------------------------------------- */
 
 /* Configure eUSCI_A2 for 115200 8N1 on P7.0/P7.1. Call after clock_init(). */
 void uart_hmi_init(void);
 
-/* Send raw bytes to the screen module (binary-safe, no direction pin). */
+/* Start sending raw bytes to the screen module by DMA and return at once
+ * (binary-safe, no direction pin). `data` must stay untouched until
+ * uart_hmi_wait_tx() returns. */
+void uart_hmi_send_async(const uint8_t *data, uint16_t len);
+
+/* Sleep in LPM0 until the DMA has handed the last HMI byte to the UART. */
+void uart_hmi_wait_tx(void);
+
+/* Blocking send: uart_hmi_send_async() + uart_hmi_wait_tx(). */
 void uart_hmi_send(const uint8_t *data, uint16_t len);
 
+/* Copy up to `max` received screen bytes into buf. Returns the count (0 if
+ * nothing is waiting). EVT_HMI_RX is posted when bytes start arriving. */
+uint8_t uart_hmi_read(uint8_t *buf, uint8_t max);
+
 #endif /* BSP_UART_H_ */
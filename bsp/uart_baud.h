@@ -0,0 +1,75 @@
+/*
+ * bsp/uart_baud.h — eUSCI_A baud-rate generator settings, computed at
+ * compile time (BSP layer).
+ *
+ * UART_BR_*(clk, baud) give the matched UCBRx / UCBRFx / UCBRSx set for
+ * `baud` from a BRCLK of `clk` Hz, by the family user guide's algorithm
+ * (oversampling mode, so N = clk / baud must be >= 16):
+ *
+ *   UCBRx  = INT(N / 16)
+ *   UCBRFx = INT(frac(N / 16) * 16)
+ *   UCBRSx = user guide table "UCBRSx settings for fractional portion of
+ *            N", looked up by frac(N)
+ *
+ * All are integer constant expressions, so they work in #if and in static
+ * initializers and cost nothing at run time. The guide's own baud-rate
+ * table was found by an error search instead, and now and then picks a
+ * different UCBRSx with the same mean rate (e.g. 38400 at 8 MHz).
+ *
+ * UART_BAUD_ERR_PPM() is the mean rate error of the resulting setting, for
+ * compile-time checks against UART_BAUD_MAX_ERR_PPM.
+ */
+
+#ifndef BSP_UART_BAUD_H_
+#define BSP_UART_BAUD_H_
+
+/* Worst mean rate error accepted for any configured rate. The receiver
+ * at the other end samples mid-bit, so a few percent would still work;
+ * 0.5 % leaves that margin to the other side's clock. */
+#define UART_BAUD_MAX_ERR_PPM   5000UL
+
+#define UART_BR_PRESCALAR(clk, baud)  ((clk) / (16UL * (baud)))
+#define UART_BR_FIRSTMOD(clk, baud)   (((clk) % (16UL * (baud))) / (baud))
+#define UART_BR_SECONDMOD(clk, baud) \
+    UART_BRS_LOOKUP(UART_FRAC_X10K(clk, baud) + 5UL)
+
+/* frac(N) in units of 1/10000. The lookup adds half a unit of the table's
+ * four-digit precision, so that e.g. 1/3 (0.3333) still selects the 0.3335
+ * row, as the guide intends. */
+#define UART_FRAC_X10K(clk, baud) \
+    ((((clk) % (baud)) * 10000UL) / (baud))
+
+#define UART_BRS_LOOKUP(f) \
+    ((f) >= 9288UL ? 0xFEu : (f) >= 9170UL ? 0xFDu : (f) >= 9004UL ? 0xFBu : \
+     (f) >= 8751UL ? 0xF7u : (f) >= 8572UL ? 0xEFu : (f) >= 8464UL ? 0xDFu : \
+     (f) >= 8333UL ? 0xBFu : (f) >= 8004UL ? 0xEEu : (f) >= 7861UL ? 0xEDu : \
+     (f) >= 7503UL ? 0xDDu : (f) >= 7147UL ? 0xBBu : (f) >= 7001UL ? 0xB7u : \
+     (f) >= 6667UL ? 0xD6u : (f) >= 6432UL ? 0xB6u : (f) >= 6254UL ? 0xB5u : \
+     (f) >= 6003UL ? 0xADu : (f) >= 5715UL ? 0x6Bu : (f) >= 5002UL ? 0xAAu : \
+     (f) >= 4378UL ? 0x55u : (f) >= 4286UL ? 0x53u : (f) >= 4003UL ? 0x92u : \
+     (f) >= 3753UL ? 0x52u : (f) >= 3575UL ? 0x4Au : (f) >= 3335UL ? 0x49u : \
+     (f) >= 3000UL ? 0x25u : (f) >= 2503UL ? 0x44u : (f) >= 2224UL ? 0x22u : \
+     (f) >= 2147UL ? 0x21u : (f) >= 1670UL ? 0x11u : (f) >= 1430UL ? 0x20u : \
+     (f) >= 1252UL ? 0x10u : (f) >= 1001UL ? 0x08u : (f) >= 835UL  ? 0x04u : \
+     (f) >= 715UL  ? 0x02u : (f) >= 529UL  ? 0x01u : 0x00u)
+
+/* Set bits of a byte: each set UCBRSx bit stretches one bit time by one
+ * BRCLK cycle, so over a character it adds popcount / 8 on average. */
+#define UART_POP8(x) \
+    ((((x) >> 0) & 1u) + (((x) >> 1) & 1u) + (((x) >> 2) & 1u) + \
+     (((x) >> 3) & 1u) + (((x) >> 4) & 1u) + (((x) >> 5) & 1u) + \
+     (((x) >> 6) & 1u) + (((x) >> 7) & 1u))
+
+/* Mean divisor of the setting, x8: 16 * UCBRx + UCBRFx + popcount / 8. */
+#define UART_DIV_X8(clk, baud) \
+    (128UL * UART_BR_PRESCALAR(clk, baud) + \
+     8UL * UART_BR_FIRSTMOD(clk, baud) + \
+     UART_POP8(UART_BR_SECONDMOD(clk, baud)))
+
+#define UART_BAUD_ERR_PPM(clk, baud) \
+    ((UART_DIV_X8(clk, baud) * (baud) > 8UL * (clk) \
+          ? UART_DIV_X8(clk, baud) * (baud) - 8UL * (clk) \
+          : 8UL * (clk) - UART_DIV_X8(clk, baud) * (baud)) \
+     / ((clk) / 125000UL))
+
+#endif /* BSP_UART_BAUD_H_ */
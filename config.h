@@ -5,7 +5,9 @@
  * timing intervals, and thresholds. This file grows one section at a time
  * as each development phase is implemented (see CLAUDE.md §9 roadmap).
  *
- * Currently implemented: Phase 1 (clock), Phase 2 (LEDs + buttons).
+ * Currently implemented: Phase 1 (clock), Phase 2 (LEDs + buttons),
+ * Phase 3 (RS485 UART), Phase 4 (ADC + sensors), Phase 5 (power + RTC),
+ * Phase 6 (I2C DAC), Phase 9 (RS485 protocol), Phase 12 (HMI).
  */
 
 #ifndef CONFIG_H_
@@ -26,13 +28,31 @@
 #define CONFIG_LFXT_FREQ_HZ     32768UL     /* 32.768 kHz low-freq crystal   */
 
 /* Resulting system clock frequencies after clock_init().
- * MCLK  = HFXT      = 8 MHz  (CPU core)
+ * MCLK  = HFXT      = 8 MHz  (CPU core; default level, see below)
  * SMCLK = HFXT      = 8 MHz  (UART, I2C, ADC, timers)
  * ACLK  = LFXT      = 32.768 kHz (RTC, low-power timing)                 */
 #define CONFIG_MCLK_FREQ_HZ     CONFIG_HFXT_FREQ_HZ
 #define CONFIG_SMCLK_FREQ_HZ    CONFIG_HFXT_FREQ_HZ
 #define CONFIG_ACLK_FREQ_HZ     CONFIG_LFXT_FREQ_HZ
 
+/* Start-up clocks: clock_init() does not wait for the crystals (a cold one
+ * takes up to hundreds of ms) but runs MCLK / SMCLK from the DCO at the
+ * same frequency as HFXT, so every baud divisor holds across the switch,
+ * and ACLK from LFMODCLK (~39 kHz). clock_poll() moves each clock onto its
+ * crystal once that has kept its fault flag clear for one poll interval. */
+#define CONFIG_DCO_FREQ_HZ      8000000UL   /* DCORSEL = 1, DCOFSEL = 3   */
+#define CLOCK_XT_POLL_MS        125u        /* crystal settle check period */
+
+/* MCLK governor (clock_set_mclk): each state runs at its own MCLK level
+ * (app/state_machine.c), SMCLK stays put. The fastest level, from the DCO,
+ * needs one FRAM wait state (above 8 MHz on this device); busy-waits sized
+ * in cycles are sized for it, so they only get longer at lower levels. */
+#define CONFIG_MCLK_MAX_FREQ_HZ 16000000UL
+/* The 1 MHz level leaves the RS485 RX interrupt (and the fast-read reply
+ * it may build) about 1000 cycles per byte at 9600 baud; at any faster
+ * link rate it is served as 8 MHz so no byte is overrun. */
+#define MCLK_LOW_MAX_BAUD       9600UL
+
 /* =====================================================================
  * LEDs & BUTTONS (Phase 2)
  * ---------------------------------------------------------------------
@@ -66,6 +86,9 @@
 #define BTN_UP_PIN      GPIO_PIN3
 #define BTN_RIGHT_PORT  GPIO_PORT_P5
 #define BTN_RIGHT_PIN   GPIO_PIN4
+#define BTN_PORT        GPIO_PORT_P5      /* all five buttons share P5 */
+#define BTN_ALL_PINS    (BTN_DOWN_PIN | BTN_SELECT_PIN | BTN_LEFT_PIN | \
+                         BTN_UP_PIN | BTN_RIGHT_PIN)
 
 /* =====================================================================
  * RS485 UART (Phase 3)   -- eUSCI_A0, our debug output link
@@ -75,23 +98,71 @@
  * We raise EN before sending and lower it once the last byte has fully
  * shifted out.
  *
- * Baud-rate generator values below are a MATCHED SET for 9600 baud from
- * an 8 MHz SMCLK using oversampling. If you change the baud or SMCLK, all
- * three (UCBRx / UCBRFx / UCBRSx) must be recalculated (see the family
- * user guide baud-rate table).
+ * The link starts at RS485_BAUD after every reset. A master may switch
+ * it to any rate of RS485_BAUD_TABLE through REG_CFG_BAUD; if no valid
+ * frame then arrives for RS485_BAUD_LINK_TIMEOUT_S, the device falls back
+ * to RS485_BAUD, where the master can always find it again.
+ *
+ * Baud-rate generator values (UCBRx / UCBRFx / UCBRSx) are computed from
+ * CONFIG_SMCLK_FREQ_HZ at compile time (bsp/uart_baud.h), and the build
+ * fails if any listed rate would be off by more than
+ * UART_BAUD_MAX_ERR_PPM.
  * ===================================================================== */
 
 #define RS485_TX_PORT   GPIO_PORT_P4      /* P4.3 = UCA0TXD */
 #define RS485_TX_PIN    GPIO_PIN3
-#define RS485_RX_PORT   GPIO_PORT_P4      /* P4.4 = UCA0RXD (used from Ph.9) */
+#define RS485_RX_PORT   GPIO_PORT_P4      /* P4.4 = UCA0RXD / listen wake  */
 #define RS485_RX_PIN    GPIO_PIN4
 #define RS485_EN_PORT   GPIO_PORT_P4
 #define RS485_EN_PIN    GPIO_PIN5
 
-#define RS485_BAUD          9600UL        /* target baud rate            */
-#define RS485_BR_PRESCALAR  52            /* UCBRx  for 9600 @ 8 MHz     */
-#define RS485_BR_FIRSTMOD   1             /* UCBRFx (oversampling)       */
-#define RS485_BR_SECONDMOD  0x49          /* UCBRSx (fractional modulation) */
+#define RS485_BAUD          9600UL        /* reset / fallback baud rate  */
+
+/* Selectable rates, X(baud) each; RS485_BAUD must be one of them. */
+#define RS485_BAUD_TABLE(X) \
+    X(9600UL) X(19200UL) X(38400UL) X(57600UL) X(115200UL)
+
+#define RS485_BAUD_LINK_TIMEOUT_S  60     /* no valid frame at a switched
+                                             rate for this long -> fall
+                                             back to RS485_BAUD           */
+
+/* --- Receive path (Phase 9) -----------------------------------------
+ * The RX ISR appends bytes to a ring buffer; a frame ends after 3.5
+ * character times of bus silence (Modbus RTU rule). Silence is timed by
+ * Timer_A1 on ACLK, so it keeps counting while the CPU sleeps.
+ *   3.5 chars * 10 bits (8N1) / 9600 baud = 3.65 ms = 120 ACLK ticks.
+ * Above 19200 baud Modbus fixes the gap at 1.75 ms (58 ticks) instead.
+ */
+#define RS485_RX_BUF_SIZE    128          /* ring bytes, power of 2 <= 128 */
+#define RS485_RX_MAX_FRAMES  4            /* queued frames, power of 2     */
+#define RS485_FRAME_GAP_TICKS(baud) \
+    ((uint16_t)((baud) > 19200UL \
+        ? (1750UL * CONFIG_ACLK_FREQ_HZ + 999999UL) / 1000000UL \
+        : (35UL * CONFIG_ACLK_FREQ_HZ + (baud) - 1) / (baud)))
+
+/* --- Listen mode ------------------------------------------------------
+ * A running eUSCI requests SMCLK, which would keep idle sleep at LPM1.
+ * After RS485_LISTEN_IDLE_MS with no traffic the UART is held in reset
+ * and the RX pin becomes a falling-edge interrupt, so the device sleeps
+ * in LPM3; the first start bit re-enables the UART. The character that
+ * carried that start bit is lost, and SMCLK (HFXT) takes up to a few ms
+ * to restart. A master talking to a device that may be asleep therefore
+ * sends one wake byte (0xFF: a lone start bit, nothing else to mis-
+ * sample), waits RS485_WAKE_LEAD_MS, then sends its request. Whatever
+ * arrives of the wake byte is a fragment shorter than 4 bytes, which the
+ * frame-gap logic drops. A master without a wake byte still works: its
+ * first request fails the CRC and times out, and the retry is heard.
+ */
+#define RS485_LISTEN_IDLE_MS 50           /* quiet time before listening   */
+#define RS485_WAKE_LEAD_MS   5            /* master: wake byte -> request;
+                                             > HFXT start-up and > 3.5 chars
+                                             at the slowest rate          */
+
+/* Transmit DMA (Phase 9). The trigger number of a UART flag depends on the
+ * channel (datasheet DMA trigger assignments): UCA0TXIFG is trigger 15 on
+ * channels 0-2, UCA2TXIFG is trigger 15 on channels 3-5. */
+#define RS485_TX_DMA_CHANNEL DMA_CHANNEL_0
+#define RS485_TX_DMA_TRIGGER DMA_TRIGGERSOURCE_15    /* UCA0TXIFG */
 
 /* =====================================================================
  * ADC & SENSORS (Phase 4)   -- ADC12_B, internal 2.5 V reference
@@ -126,6 +197,19 @@
 #define ADC_MOTOR_I_PORT    GPIO_PORT_P2
 #define ADC_MOTOR_I_PIN     GPIO_PIN3
 
+/* --- Oversampling (sensor_read_all) ------------------------------------
+ * The sequence read converts every input 2^n times and sums the samples
+ * in integers; each 4x buys one more bit on the noise the signal carries,
+ * so 256x gives 16 effective bits. n per input, 0..8 (1x .. 256x). The
+ * five-input sequence runs 2^max(n) times at ~40 us each, i.e. ~10 ms
+ * per measurement at 256x, with the CPU in LPM0 between sequences.
+ */
+#define ADC_OSR_LOG2_PANEL_V    4     /* 16x  -> 14 bits                */
+#define ADC_OSR_LOG2_BATT_V     4     /* 16x  -> 14 bits                */
+#define ADC_OSR_LOG2_PANEL_I    8     /* 256x -> 16 bits (noisy IMON)   */
+#define ADC_OSR_LOG2_BATT_I     6     /* 64x  -> 15 bits                */
+#define ADC_OSR_LOG2_MOTOR_I    2     /* 4x   -> 13 bits                */
+
 /* --- Sensor scaling (calibration) --------------------------------------
  * From the board's divider / shunt / gain values. drivers/sensors.c applies
  * these to Vadc (the voltage at the ADC pin). Change these if the board's
@@ -147,18 +231,68 @@
 #define SENSOR_MOTOR_I_RSHUNT   0.005f      /* motor shunt resistor   */
 #define SENSOR_MOTOR_I_GAIN     20.0f       /* motor current-sense gain */
 
+/* Motor stall threshold (Phase 7). Above this current the ADC window
+ * comparator interrupts MOTOR_CTRL (bsp/adc stall watch), so the valve
+ * travel needs no polling. x100 A; set from the motor's stall current
+ * once it is characterised. */
+#define MOTOR_STALL_I_X100      150         /* 1.50 A                 */
+
 /* =====================================================================
  * POWER MANAGEMENT + RTC (Phase 5)
  * ---------------------------------------------------------------------
- * The RTC (clocked from the LF crystal / ACLK) produces a 1 Hz tick; the
- * ISR counts ticks and raises a "measurement due" flag every
- * MEASURE_INTERVAL_S seconds, which wakes the CPU from low-power sleep.
+ * The RTC (clocked from the LF crystal / ACLK) is programmed straight to
+ * the next deadline (bsp/timer), so the CPU wakes once per
+ * MEASURE_INTERVAL_S instead of once per second.
  * ===================================================================== */
 
 #define MEASURE_INTERVAL_S   3    /* seconds between wake-ups.
                                     * Use a small value (e.g. 3) to test
                                     * the wake cycle without waiting a minute. */
 
+#define RTC_NUM_DEADLINES    4    /* concurrent RTC deadlines (max 8)    */
+
+/* LPM3.5 deep sleep. When the main loop goes idle with the RS485 link in
+ * listen mode, no motor watch running and the next RTC deadline at least
+ * POWER_DEEP_SLEEP_MIN_S away, it sleeps in LPM3.5 rather than LPM3: RAM
+ * and the core are powered down, only the RTC_C and the port wake logic
+ * stay on. The wake-up is a reset; the application context is kept in
+ * FRAM (#pragma PERSISTENT), and the state machine resumes without the
+ * full init, bringing peripherals up as the next state needs them.
+ *
+ * The resume costs about as much charge as a few seconds of the LPM3 vs
+ * LPM3.5 current difference, so short sleeps stay in LPM3. To tune this,
+ * compare the average supply current over a few cycles with the value
+ * below and with 0, or REG_PROF_CHARGE_NC_CYCLE (energy profiler below),
+ * and read the resume time from REG_DIAG_RESUME_ACLK
+ * (REG_DIAG_DEEP_RESUMES counts the resumes).
+ * 0 = never use LPM3.5. */
+#define POWER_DEEP_SLEEP_MIN_S  10
+
+/* Energy profiler (app/profile). When non-zero, the state machine times
+ * every state and sleep mode on a free-running ACLK timer (bsp/timer
+ * timebase) and estimates the charge drawn per measurement cycle from
+ * the board currents below; REG_PROF_* (app/comm_protocol.h) shows the
+ * result, and writing REG_PROF_RESET restarts it. 0 = off (no timer, no
+ * overflow wake-ups).
+ *
+ * The currents are whole-board estimates in uA (max 65535) at each
+ * state's MCLK level: start from the datasheet and a bench measurement,
+ * then refine them until the profile matches a long-run supply reading.
+ * The motor's own draw is not in them: it runs while the CPU sleeps, and
+ * REG_MOTOR_CURRENT measures it. */
+#define PROFILE_ENABLE          1
+#define PROFILE_I_UA_INIT       1500
+#define PROFILE_I_UA_IDLE       1100      /* awake between handlers     */
+#define PROFILE_I_UA_MEASURE    1400      /* 8 MHz + ADC + reference    */
+#define PROFILE_I_UA_TRANSMIT   2500      /* RS485 driver on            */
+#define PROFILE_I_UA_CMD        1100
+#define PROFILE_I_UA_MOTOR      1300
+#define PROFILE_I_UA_FAULT      1100
+#define PROFILE_I_UA_BUTTON     1100
+#define PROFILE_I_UA_HMI_RX     1100
+#define PROFILE_I_UA_LPM3       40        /* RS485 receiver listening   */
+#define PROFILE_I_UA_LPM35      30
+
 /* =====================================================================
  * I2C + MCP4706 DAC (Phase 6)   -- eUSCI_B0, motor speed reference
  * ---------------------------------------------------------------------
@@ -185,12 +319,58 @@
  * ---------------------------------------------------------------------
  * Frame: [address][function][data...][CRC16_lo][CRC16_hi]
  * CRC16 uses the Modbus polynomial (0xA001, init 0xFFFF) and is appended
- * low byte first (Modbus convention). This device answers to one address.
+ * low byte first (Modbus convention). This device answers to one address;
+ * it also accepts unanswered writes on the broadcast address (0) and on
+ * the group addresses it is a member of.
  * ===================================================================== */
 
 #define RS485_DEVICE_ADDRESS   0x01       /* this device's bus address     */
+#define RS485_GROUP_MASK       0x00       /* default REG_CFG_GROUPS: bit n =
+                                           * member of group address 248+n */
 #define RS485_MAX_FRAME        64         /* max frame length, bytes       */
 
+/* CRC16 backend (drivers/crc16.h): CRC16_BACKEND_TABLE (512 B FRAM, one
+ * lookup per byte), _NIBBLE (32 B, two lookups) or _BITWISE (no table).
+ * The on-chip CRC module is CCITT-only, so _HW is not allowed here. */
+#define RS485_CRC_BACKEND      CRC16_BACKEND_TABLE
+
+/* CRC16 benchmark. When non-zero, INIT runs crc16_bench() once: every
+ * backend, HW included, timed on Timer_A0 over CRC16_BENCH_LEN bytes and
+ * checked against the bitwise reference, result in g_crc16_bench (CCS
+ * Expressions view). For choosing the backends above; 0 in the field. */
+#define CRC16_BENCH_ENABLE     0
+#define CRC16_BENCH_LEN        64         /* bytes, <= 255                 */
+
+/* Report by exception. A telemetry report (MODBUS_FUNC_REPORT) is sent
+ * only when a register has moved by at least its deadband since the value
+ * last reported, and then carries only those registers. After
+ * REPORT_HEARTBEAT_S without any report, a full report is sent anyway.
+ * Deadbands are in register units (x100 for V / A); 0 = any change.
+ * These are the defaults: the center can change them at run time through
+ * the REG_CFG_* registers (app/comm_protocol.h). */
+#define REPORT_HEARTBEAT_S     900        /* max silence, seconds          */
+#define REPORT_DB_FLOW         10         /* 0.10 flow units               */
+#define REPORT_DB_BATT_V       10         /* 0.10 V                        */
+#define REPORT_DB_BATT_I       5          /* 0.05 A                        */
+#define REPORT_DB_PANEL_V      50         /* 0.50 V                        */
+#define REPORT_DB_PANEL_I      5          /* 0.05 A                        */
+#define REPORT_DB_MOTOR_I      5          /* 0.05 A                        */
+#define REPORT_DB_MOTOR_SPEED  5          /* 5 %                           */
+#define REPORT_DB_VALVE_POS    0          /* every change                  */
+#define REPORT_DB_LT8490       0          /* every change                  */
+
+/* Aggregated reporting. When non-zero, per-cycle reports are replaced by
+ * one MODBUS_FUNC_REPORT_AGG frame (min/max/mean of every register) per
+ * REPORT_AGG_CYCLES measurement cycles, so sampling (MEASURE_INTERVAL_S)
+ * and radio traffic are tuned separately. 0 = report by exception every
+ * cycle (the deadbands above). */
+#define REPORT_AGG_CYCLES      0
+
+/* Telemetry history (app/telem_log): one FRAM record (30 B) per
+ * measurement cycle, oldest overwritten. 256 records = 7.5 KB of FRAM,
+ * i.e. 256 x MEASURE_INTERVAL_S of history for the center to backfill. */
+#define TELEM_LOG_CAPACITY     256
+
 /* =====================================================================
  * HMI SCREEN (Phase 12)   -- eUSCI_A2, TY040HDL04NF "Giraffe" protocol
  * ---------------------------------------------------------------------
@@ -198,8 +378,8 @@
  * level shifter. UCA2TXD/UCA2RXD are the PRIMARY module function on
  * P7.0/P7.1 (datasheet Table 9-35).
  *
- * Baud generator is a MATCHED SET for 115200 from an 8 MHz SMCLK with
- * oversampling; recalculate all three if the baud or SMCLK changes.
+ * Baud generator values are computed from CONFIG_SMCLK_FREQ_HZ at compile
+ * time, like the RS485 ones.
  *
  * Screen control lines: AUDIO-PA-EN is active-LOW for audio, so we hold it
  * HIGH to keep the audio amplifier off.
@@ -212,9 +392,9 @@
 #define HMI_PIN_MUX     GPIO_PRIMARY_MODULE_FUNCTION
 
 #define HMI_BAUD             115200UL
-#define HMI_BR_PRESCALAR     4            /* UCBRx  for 115200 @ 8 MHz   */
-#define HMI_BR_FIRSTMOD      5            /* UCBRFx (oversampling)       */
-#define HMI_BR_SECONDMOD     0x55         /* UCBRSx (fractional mod.)    */
+
+#define HMI_TX_DMA_CHANNEL   DMA_CHANNEL_3   /* see RS485_TX_DMA_CHANNEL   */
+#define HMI_TX_DMA_TRIGGER   DMA_TRIGGERSOURCE_15   /* UCA2TXIFG on ch 3-5 */
 
 /* Screen connector control lines (plain GPIO). */
 #define HMI_PE9_PORT        GPIO_PORT_P7  /* P7.3 - generic GPIO         */
@@ -227,12 +407,17 @@
 #define HMI_SPK_PIN         GPIO_PIN6
 
 #define HMI_MAX_FRAME        64           /* max Giraffe frame, bytes    */
+#define HMI_RX_BUF_SIZE      32           /* RX ring bytes, power of 2   */
 #define HMI_DEFAULT_BRIGHTNESS  60        /* 0-100, startup backlight    */
 
 /* CRC16-CCITT on the HMI link. MUST match "CRC Enable" in the Giraffe IDE
  * project; the vendor examples run with it off, so we start disabled. */
 #define HMI_CRC_ENABLED      0
 
+/* CRC16-CCITT backend (drivers/crc16.h). The on-chip CRC16 module
+ * implements exactly this polynomial, so use it. */
+#define HMI_CRC_BACKEND      CRC16_BACKEND_HW
+
 /* Screen layout IDs — FILL IN after the GUI is built in the Giraffe IDE.
  * Every label/widget there gets a page ID and a control ID; put them here
  * and then enable the writes in hmi_update(). */
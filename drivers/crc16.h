@@ -0,0 +1,70 @@
+/*
+ * drivers/crc16.h — CRC16 engine with selectable backends (driver layer).
+ *
+ * Two CRC16 flavors are used on the board's links:
+ *   Modbus : poly 0xA001 (reflected 0x8005), LSB-first   -> drivers/rs485
+ *   CCITT  : poly 0x1021, MSB-first                      -> drivers/hmi
+ *
+ * Each has several interchangeable backends that produce bit-identical
+ * results; config.h picks one per link (RS485_CRC_BACKEND,
+ * HMI_CRC_BACKEND) as a speed vs. FRAM trade-off:
+ *   BITWISE : 8 shift/XOR rounds per byte, no table (the reference)
+ *   NIBBLE  : two lookups per byte in a 16-entry table (32 bytes)
+ *   TABLE   : one lookup per byte in a 256-entry table (512 bytes)
+ *   HW      : the on-chip CRC16 module (bsp/crc). Its polynomial is fixed
+ *             to 0x1021, so it can only serve the CCITT flavor.
+ *
+ * All functions take the running CRC and return the updated one, so a
+ * frame can be checksummed in pieces: pass 0xFFFF (Modbus) or 0x0000
+ * (CCITT/XMODEM) as the initial value.
+ */
+
+#ifndef DRIVERS_CRC16_H_
+#define DRIVERS_CRC16_H_
+
+#include <stdint.h>
+
+/* Backend IDs for RS485_CRC_BACKEND / HMI_CRC_BACKEND in config.h. */
+#define CRC16_BACKEND_BITWISE   0
+#define CRC16_BACKEND_NIBBLE    1
+#define CRC16_BACKEND_TABLE     2
+#define CRC16_BACKEND_HW        3
+
+/* Modbus CRC16 through the backend selected by RS485_CRC_BACKEND. */
+uint16_t crc16_modbus(uint16_t crc, const uint8_t *data, uint16_t len);
+
+/* One byte of Modbus CRC16, same backend. For callers that checksum a
+ * frame while they write it (drivers/rs485 frame builder). */
+uint16_t crc16_modbus_byte(uint16_t crc, uint8_t b);
+
+/* CCITT CRC16 through the backend selected by HMI_CRC_BACKEND. */
+uint16_t crc16_ccitt(uint16_t crc, const uint8_t *data, uint16_t len);
+
+/* Individual software backends, exposed so they can be cross-checked
+ * against each other and timed side by side. */
+uint16_t crc16_modbus_bitwise(uint16_t crc, const uint8_t *data, uint16_t len);
+uint16_t crc16_modbus_nibble(uint16_t crc, const uint8_t *data, uint16_t len);
+uint16_t crc16_modbus_table(uint16_t crc, const uint8_t *data, uint16_t len);
+
+uint16_t crc16_ccitt_bitwise(uint16_t crc, const uint8_t *data, uint16_t len);
+uint16_t crc16_ccitt_nibble(uint16_t crc, const uint8_t *data, uint16_t len);
+uint16_t crc16_ccitt_table(uint16_t crc, const uint8_t *data, uint16_t len);
+
+/* Benchmark result (crc16_bench). Cost is SMCLK cycles per byte x16 over
+ * a CRC16_BENCH_LEN-byte buffer, call overhead taken out; at the 8 MHz
+ * MCLK level those are CPU cycles. Backend order: bitwise, nibble,
+ * table (, HW for CCITT). */
+typedef struct {
+    uint16_t modbus_x16[3];
+    uint16_t ccitt_x16[4];
+    uint8_t  match;     /* 1: every backend gave the bitwise result */
+} crc16_bench_t;
+
+/*
+ * crc16_bench() — time every backend, HW included, on Timer_A0 and check
+ * it against the bitwise reference. Blocking, a few ms. Only built with
+ * CRC16_BENCH_ENABLE (config.h); Timer_A0 is stopped again afterwards.
+ */
+void crc16_bench(crc16_bench_t *r);
+
+#endif /* DRIVERS_CRC16_H_ */
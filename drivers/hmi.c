@@ -6,6 +6,7 @@
 
 #include "config.h"
 #include "bsp/uart.h"
+#include "drivers/crc16.h"
 #include "drivers/hmi.h"
 
 /* System (0xB0) function commands */
@@ -24,24 +25,8 @@
 
 uint16_t hmi_crc16_ccitt(const uint8_t *data, uint16_t len)
 {
-    uint16_t crc = 0x0000;          /* CCITT/XMODEM init */
-    uint16_t i;
-
-    for (i = 0; i < len; i++)
-    {
-        crc ^= (uint16_t)((uint16_t)data[i] << 8);   /* fold byte into MSB */
-
-        uint8_t bit;
-        for (bit = 0; bit < 8; bit++)
-        {
-            if (crc & 0x8000)       /* MSB-first, unlike the Modbus CRC */
-                crc = (uint16_t)((crc << 1) ^ 0x1021);
-            else
-                crc = (uint16_t)(crc << 1);
-        }
-    }
-
-    return crc;
+    /* CCITT/XMODEM init 0x0000; backend chosen by HMI_CRC_BACKEND. */
+    return crc16_ccitt(0x0000, data, len);
 }
 
 uint8_t hmi_build_frame(uint8_t *out, uint8_t op, uint8_t type,
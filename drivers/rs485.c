@@ -5,33 +5,92 @@
  */
 
 #include "config.h"
+#include "drivers/crc16.h"
 #include "drivers/rs485.h"
 
 uint16_t rs485_crc16(const uint8_t *data, uint16_t len)
 {
-    uint16_t crc = 0xFFFF;
-    uint16_t i;
+    /* Backend chosen by RS485_CRC_BACKEND; all give the same result. */
+    return crc16_modbus(0xFFFF, data, len);
+}
+
+/* Room for payload: everything but the 2 trailing CRC bytes. */
+#define FRAME_PAYLOAD_END   (RS485_MAX_FRAME - 2)
+
+void rs485_frame_begin(rs485_frame_t *f, uint8_t *out,
+                       uint8_t address, uint8_t function)
+{
+    f->buf      = out;
+    f->len      = 0;
+    f->overflow = 0;
+    f->crc      = 0xFFFF;
+    rs485_frame_put_u8(f, address);
+    rs485_frame_put_u8(f, function);
+}
+
+void rs485_frame_put_u8(rs485_frame_t *f, uint8_t b)
+{
+    if (f->len >= FRAME_PAYLOAD_END)
+    {
+        f->overflow = 1;
+        return;
+    }
+    f->buf[f->len++] = b;
+    f->crc = crc16_modbus_byte(f->crc, b);
+}
+
+void rs485_frame_put_u16(rs485_frame_t *f, uint16_t v)
+{
+    rs485_frame_put_u8(f, (uint8_t)(v >> 8));     /* Modbus: hi byte first */
+    rs485_frame_put_u8(f, (uint8_t)(v & 0xFF));
+}
+
+void rs485_frame_put_u32(rs485_frame_t *f, uint32_t v)
+{
+    rs485_frame_put_u16(f, (uint16_t)(v >> 16));
+    rs485_frame_put_u16(f, (uint16_t)(v & 0xFFFF));
+}
+
+uint8_t *rs485_frame_tail(const rs485_frame_t *f)
+{
+    return &f->buf[f->len];
+}
 
-    for (i = 0; i < len; i++)
+uint8_t rs485_frame_room(const rs485_frame_t *f)
+{
+    return (uint8_t)(FRAME_PAYLOAD_END - f->len);
+}
+
+void rs485_frame_commit(rs485_frame_t *f, uint8_t n)
+{
+    if (n > rs485_frame_room(f))
     {
-        crc ^= (uint16_t)data[i];        /* fold in the next byte      */
-
-        uint8_t bit;
-        for (bit = 0; bit < 8; bit++)
-        {
-            if (crc & 0x0001)            /* LSB set -> shift and XOR   */
-            {
-                crc >>= 1;
-                crc ^= 0xA001;           /* Modbus reversed polynomial */
-            }
-            else
-            {
-                crc >>= 1;
-            }
-        }
+        f->overflow = 1;
+        return;
     }
+    f->crc = crc16_modbus(f->crc, &f->buf[f->len], n);
+    f->len = (uint8_t)(f->len + n);
+}
 
-    return crc;
+void rs485_frame_commit_crc(rs485_frame_t *f, uint8_t n, uint16_t crc)
+{
+    if (n > rs485_frame_room(f))
+    {
+        f->overflow = 1;
+        return;
+    }
+    f->crc = crc;
+    f->len = (uint8_t)(f->len + n);
+}
+
+uint8_t rs485_frame_end(rs485_frame_t *f)
+{
+    if (f->overflow)
+        return 0;
+
+    f->buf[f->len]     = (uint8_t)(f->crc & 0xFF);          /* low byte first */
+    f->buf[f->len + 1] = (uint8_t)((f->crc >> 8) & 0xFF);   /* then high byte */
+    return (uint8_t)(f->len + 2);
 }
 
 uint8_t rs485_build_frame(uint8_t *out,
@@ -40,24 +99,18 @@ uint8_t rs485_build_frame(uint8_t *out,
                           const uint8_t *data,
                           uint8_t data_len)
 {
-    /* total = address + function + data + 2 CRC bytes */
-    uint8_t total = (uint8_t)(2 + data_len + 2);
-    if (total > RS485_MAX_FRAME)
-        return 0;
-
-    out[0] = address;
-    out[1] = function;
-
+    rs485_frame_t f;
     uint8_t i;
-    for (i = 0; i < data_len; i++)
-        out[2 + i] = data[i];
 
-    /* CRC over everything before the CRC field. */
-    uint16_t crc = rs485_crc16(out, (uint16_t)(2 + data_len));
-    out[2 + data_len]     = (uint8_t)(crc & 0xFF);        /* low byte first */
-    out[2 + data_len + 1] = (uint8_t)((crc >> 8) & 0xFF); /* then high byte */
+    rs485_frame_begin(&f, out, address, function);
+    if (data_len > rs485_frame_room(&f))
+        return 0;
 
-    return total;
+    uint8_t *p = rs485_frame_tail(&f);
+    for (i = 0; i < data_len; i++)
+        p[i] = data[i];
+    rs485_frame_commit(&f, data_len);
+    return rs485_frame_end(&f);
 }
 
 uint8_t rs485_check_frame(const uint8_t *frame, uint8_t len)
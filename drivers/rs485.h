@@ -18,6 +18,7 @@
 
 /*
  * rs485_crc16() — Modbus CRC16 (poly 0xA001, init 0xFFFF) over `len` bytes.
+ * Computed by the backend selected with RS485_CRC_BACKEND (drivers/crc16).
  */
 uint16_t rs485_crc16(const uint8_t *data, uint16_t len);
 
@@ -26,6 +27,8 @@ uint16_t rs485_crc16(const uint8_t *data, uint16_t len);
  *   out = [address][function][data...][CRC_lo][CRC_hi]
  * Returns the total frame length (2 + data_len + 2), or 0 if it would
  * exceed RS485_MAX_FRAME. `out` must hold at least RS485_MAX_FRAME bytes.
+ * For payloads that are already in a buffer; frames that are generated
+ * field by field use the builder below instead.
  */
 uint8_t rs485_build_frame(uint8_t *out,
                           uint8_t address,
@@ -33,6 +36,41 @@ uint8_t rs485_build_frame(uint8_t *out,
                           const uint8_t *data,
                           uint8_t data_len);
 
+/*
+ * In-place frame builder. rs485_frame_begin() writes the header straight
+ * into the output buffer; payload bytes are then written where they end
+ * up on the wire, and the CRC is folded in as they go, so there is no
+ * staging copy and no second CRC pass. rs485_frame_end() appends the CRC.
+ *
+ *   rs485_frame_t f;
+ *   rs485_frame_begin(&f, out, addr, func);
+ *   rs485_frame_put_u16(&f, value);          ... any number of puts
+ *   len = rs485_frame_end(&f);               0 if it did not fit
+ *
+ * For bulk payloads produced elsewhere, write them at rs485_frame_tail()
+ * (at most rs485_frame_room() bytes) and then rs485_frame_commit() them;
+ * the CRC is taken over that block in one pass.
+ */
+typedef struct {
+    uint8_t *buf;       /* frame start (the caller's output buffer)    */
+    uint8_t  len;       /* bytes written so far, header included       */
+    uint8_t  overflow;  /* a put did not fit: end() will return 0      */
+    uint16_t crc;       /* Modbus CRC over buf[0 .. len)               */
+} rs485_frame_t;
+
+void rs485_frame_begin(rs485_frame_t *f, uint8_t *out,
+                       uint8_t address, uint8_t function);
+void rs485_frame_put_u8(rs485_frame_t *f, uint8_t b);
+void rs485_frame_put_u16(rs485_frame_t *f, uint16_t v);     /* big-endian */
+void rs485_frame_put_u32(rs485_frame_t *f, uint32_t v);     /* big-endian */
+uint8_t *rs485_frame_tail(const rs485_frame_t *f);
+uint8_t  rs485_frame_room(const rs485_frame_t *f);
+void rs485_frame_commit(rs485_frame_t *f, uint8_t n);
+/* As rs485_frame_commit(), when the caller already knows the running CRC
+ * after those n bytes (cached from an identical earlier frame). */
+void rs485_frame_commit_crc(rs485_frame_t *f, uint8_t n, uint16_t crc);
+uint8_t rs485_frame_end(rs485_frame_t *f);
+
 /*
  * rs485_check_frame() — verify a received frame's trailing CRC16.
  * Returns 1 if the CRC matches (frame intact), 0 otherwise. `len` is the
@@ -1,8 +1,11 @@
 /*
- * drivers/sensors.c — Analog measurements in real units.
+ * drivers/sensors.c — Analog measurements in register units.
  *
- * Each function reads its ADC channel, converts the raw 12-bit code to the
- * voltage at the ADC pin, then applies the channel's scaling formula.
+ * Each function reads its ADC input and converts the code straight to the
+ * x100 register encoding with one fixed-point multiply. sensor_read_all()
+ * converts all five from one oversampled ADC sequence read, whose codes
+ * are on a 16-bit scale (bsp/adc.h); single reads are 12-bit codes, moved
+ * onto the same scale.
  *
  * Formulas (from CLAUDE.md §2.1), where Vadc is the voltage at the pin:
  *   Panel V   = Vadc * (75k + 10k) / 10k          = Vadc * 8.5
@@ -10,6 +13,14 @@
  *   Panel I   = (Vadc / 21k - 7uA) * 1000 / 0.012
  *   Battery I = Vadc / 0.405
  *   Motor I   = Vadc / (0.005 * 20)               = Vadc / 0.1
+ *
+ * With Vadc = raw * VREF / 4096, every formula is linear in raw:
+ *   x100 = (raw * GAIN - OFFSET) >> SENSOR_Q
+ * and a 16-bit code is simply raw = code16 / 16, fraction kept.
+ * GAIN (x100 per ADC LSB) and OFFSET are Q16 constants folded by the
+ * compiler from the float SENSOR_* values in config.h, so no float code is
+ * emitted. Only the panel current has an offset (the IMON bias current);
+ * a negative result clamps to 0, like the float version did.
  */
 
 #include <msp430.h>
@@ -18,41 +29,132 @@
 #include "bsp/adc.h"
 #include "drivers/sensors.h"
 
-/* Convert a raw ADC code to the voltage present at the ADC pin. */
-static float adc_to_pin_volts(uint16_t raw)
+#define SENSOR_Q        16
+#define SENSOR_Q_ONE    65536.0f
+
+/* Pin volts per ADC code. */
+#define VOLTS_PER_LSB   (ADC_VREF_VOLTS / ADC_FULL_SCALE)
+
+/* Real-unit value -> Q16 x100 constant, rounded. */
+#define Q16_X100(x)     ((uint32_t)((x) * 100.0f * SENSOR_Q_ONE + 0.5f))
+
+#define GAIN_PANEL_V    Q16_X100(VOLTS_PER_LSB * \
+                            ((SENSOR_PANEL_V_RTOP + SENSOR_PANEL_V_RBOT) \
+                             / SENSOR_PANEL_V_RBOT))
+#define GAIN_BATT_V     Q16_X100(VOLTS_PER_LSB * \
+                            ((SENSOR_BATT_V_RTOP + SENSOR_BATT_V_RBOT) \
+                             / SENSOR_BATT_V_RBOT))
+#define GAIN_PANEL_I    Q16_X100(VOLTS_PER_LSB * \
+                            (1000.0f / (SENSOR_PANEL_I_RIMON \
+                                        * SENSOR_PANEL_I_RSENSE)))
+#define OFFSET_PANEL_I  Q16_X100(SENSOR_PANEL_I_IBIAS \
+                                 * (1000.0f / SENSOR_PANEL_I_RSENSE))
+#define GAIN_BATT_I     Q16_X100(VOLTS_PER_LSB / SENSOR_BATT_I_DIV)
+#define GAIN_MOTOR_I    Q16_X100(VOLTS_PER_LSB / \
+                            (SENSOR_MOTOR_I_RSHUNT * SENSOR_MOTOR_I_GAIN))
+
+typedef struct {
+    adc_input_t input;      /* ADC memory buffer / input         */
+    uint32_t    gain;       /* x100 per ADC code, Q16            */
+    uint32_t    offset;     /* x100 subtracted after gain, Q16   */
+} sensor_cal_t;
+
+/* Indexed by sensor_id_t. const -> lives in FRAM. */
+static const sensor_cal_t s_cal[SENSOR_COUNT] = {
+    { ADC_IN_PANEL_V, GAIN_PANEL_V, 0              },
+    { ADC_IN_BATT_V,  GAIN_BATT_V,  0              },
+    { ADC_IN_PANEL_I, GAIN_PANEL_I, OFFSET_PANEL_I },
+    { ADC_IN_BATT_I,  GAIN_BATT_I,  0              },
+    { ADC_IN_MOTOR_I, GAIN_MOTOR_I, 0              },
+};
+
+uint16_t sensor_code16_to_x100(sensor_id_t id, uint16_t code16)
+{
+    const sensor_cal_t *c = &s_cal[id];
+
+    /* code16 * gain / 16 without a 36-bit product: the gain (< 2^20) is
+     * split at bit 4 so each part fits 32 bits, and the result is exactly
+     * raw * gain for a 12-bit code moved up by 4. The project builds with
+     * --use_hw_mpy=F5, so these multiplies run on the MPY32 peripheral. */
+    uint32_t acc = (uint32_t)code16 * (c->gain >> 4) +
+                   (((uint32_t)code16 * (c->gain & 0xF)) >> 4);
+
+    if (acc <= c->offset)
+        return 0;
+    acc = (acc - c->offset) >> SENSOR_Q;
+
+    return (acc > 0xFFFFUL) ? 0xFFFFu : (uint16_t)acc;
+}
+
+uint16_t sensor_raw_to_x100(sensor_id_t id, uint16_t raw)
+{
+    return sensor_code16_to_x100(id, (uint16_t)(raw << 4));
+}
+
+uint16_t sensor_x100_to_raw(sensor_id_t id, uint16_t x100)
+{
+    /* Binary search over the codes: the conversion is monotonic, and this
+     * way the threshold agrees with sensor_raw_to_x100() exactly,
+     * rounding included. Called rarely (when a threshold is set). */
+    uint16_t lo = 0, hi = 4095;
+
+    if (sensor_raw_to_x100(id, 0) > x100)
+        return 0;
+    while (lo < hi)
+    {
+        uint16_t mid = (uint16_t)((lo + hi + 1) / 2);
+        if (sensor_raw_to_x100(id, mid) <= x100)
+            lo = mid;
+        else
+            hi = (uint16_t)(mid - 1);
+    }
+    return lo;
+}
+
+/* Read one channel and scale it. */
+static uint16_t sensor_read_x100(sensor_id_t id)
+{
+    return sensor_raw_to_x100(id, adc_read_raw(s_cal[id].input));
+}
+
+void sensor_read_all(telemetry_t *t)
 {
-    return ((float)raw * ADC_VREF_VOLTS) / ADC_FULL_SCALE;
+    uint16_t code[ADC_IN_COUNT];
+    adc_read_sequence(code);   /* oversampled, CPU in LPM0 meanwhile */
+
+    t->panel_voltage = sensor_code16_to_x100(
+                           SENSOR_PANEL_V, code[s_cal[SENSOR_PANEL_V].input]);
+    t->batt_voltage  = sensor_code16_to_x100(
+                           SENSOR_BATT_V,  code[s_cal[SENSOR_BATT_V].input]);
+    t->panel_current = sensor_code16_to_x100(
+                           SENSOR_PANEL_I, code[s_cal[SENSOR_PANEL_I].input]);
+    t->batt_current  = sensor_code16_to_x100(
+                           SENSOR_BATT_I,  code[s_cal[SENSOR_BATT_I].input]);
+    t->motor_current = sensor_code16_to_x100(
+                           SENSOR_MOTOR_I, code[s_cal[SENSOR_MOTOR_I].input]);
 }
 
-float sensor_panel_voltage(void)
+uint16_t sensor_panel_voltage_x100(void)
 {
-    float vadc = adc_to_pin_volts(adc_read_raw(ADC_PANEL_V_CH));
-    return vadc * ((SENSOR_PANEL_V_RTOP + SENSOR_PANEL_V_RBOT)
-                   / SENSOR_PANEL_V_RBOT);
+    return sensor_read_x100(SENSOR_PANEL_V);
 }
 
-float sensor_battery_voltage(void)
+uint16_t sensor_battery_voltage_x100(void)
 {
-    float vadc = adc_to_pin_volts(adc_read_raw(ADC_BATT_V_CH));
-    return vadc * ((SENSOR_BATT_V_RTOP + SENSOR_BATT_V_RBOT)
-                   / SENSOR_BATT_V_RBOT);
+    return sensor_read_x100(SENSOR_BATT_V);
 }
 
-float sensor_panel_current(void)
+uint16_t sensor_panel_current_x100(void)
 {
-    float vadc = adc_to_pin_volts(adc_read_raw(ADC_PANEL_I_CH));
-    return (vadc / SENSOR_PANEL_I_RIMON - SENSOR_PANEL_I_IBIAS)
-           * (1000.0f / SENSOR_PANEL_I_RSENSE);
+    return sensor_read_x100(SENSOR_PANEL_I);
 }
 
-float sensor_battery_current(void)
+uint16_t sensor_battery_current_x100(void)
 {
-    float vadc = adc_to_pin_volts(adc_read_raw(ADC_BATT_I_CH));
-    return vadc / SENSOR_BATT_I_DIV;
+    return sensor_read_x100(SENSOR_BATT_I);
 }
 
-float sensor_motor_current(void)
+uint16_t sensor_motor_current_x100(void)
 {
-    float vadc = adc_to_pin_volts(adc_read_raw(ADC_MOTOR_I_CH));
-    return vadc / (SENSOR_MOTOR_I_RSHUNT * SENSOR_MOTOR_I_GAIN);
+    return sensor_read_x100(SENSOR_MOTOR_I);
 }
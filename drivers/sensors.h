@@ -1,18 +1,61 @@
 /*
- * drivers/sensors.h — Analog measurements in real units (driver layer).
+ * drivers/sensors.h — Analog measurements in register units (driver layer).
  *
  * Wraps bsp/adc: reads each ADC channel and applies its board-specific
- * scaling formula (divider ratios, shunt/gain values) to return volts or
- * amps. Formulas are documented in CLAUDE.md §2.1.
+ * scaling formula (divider ratios, shunt/gain values, CLAUDE.md §2.1).
+ * Results come straight out in the telemetry register encoding, x100
+ * (0.01 V / 0.01 A), clamped to 0..65535, using integer math only — the
+ * MSP430 has no FPU, and soft-float costs hundreds of cycles per reading.
  */
 
 #ifndef DRIVERS_SENSORS_H_
 #define DRIVERS_SENSORS_H_
 
-float sensor_panel_voltage(void);    /* solar panel voltage,   volts */
-float sensor_battery_voltage(void);  /* battery voltage,       volts */
-float sensor_panel_current(void);    /* panel current,         amps  */
-float sensor_battery_current(void);  /* battery current,       amps  */
-float sensor_motor_current(void);    /* motor current,         amps  */
+#include <stdint.h>
+#include "telemetry.h"   /* shared data model — not an app-layer header */
+
+/* The five analog measurements. */
+typedef enum {
+    SENSOR_PANEL_V,
+    SENSOR_BATT_V,
+    SENSOR_PANEL_I,
+    SENSOR_BATT_I,
+    SENSOR_MOTOR_I,
+    SENSOR_COUNT
+} sensor_id_t;
+
+/*
+ * sensor_raw_to_x100() — convert a raw 12-bit ADC code of the given
+ * channel to its x100 register value. Pure integer math, no ADC access.
+ */
+uint16_t sensor_raw_to_x100(sensor_id_t id, uint16_t raw);
+
+/*
+ * sensor_code16_to_x100() — the same for a code on the 16-bit scale of
+ * adc_read_sequence() (oversampled and decimated; raw 12-bit code x 16).
+ */
+uint16_t sensor_code16_to_x100(sensor_id_t id, uint16_t code16);
+
+/*
+ * sensor_x100_to_raw() — the inverse: the largest raw 12-bit code that
+ * still reads as <= x100 on that channel, e.g. for a hardware threshold
+ * that should trip only above x100. 4095 if the whole range does.
+ */
+uint16_t sensor_x100_to_raw(sensor_id_t id, uint16_t x100);
+
+/*
+ * sensor_read_all() — convert all five inputs in one oversampled ADC
+ * sequence read (ADC_OSR_LOG2_*, up to 16 effective bits) and fill
+ * the panel/battery voltage and current and motor current fields of `t`.
+ * Other fields are left untouched. Sleeps in LPM0 during the conversion.
+ */
+void sensor_read_all(telemetry_t *t);
+
+/* Single-input reads (one conversion each), e.g. for motor-current polling. */
+uint16_t sensor_panel_voltage_x100(void);    /* solar panel voltage, x100 V */
+uint16_t sensor_battery_voltage_x100(void);  /* battery voltage,     x100 V */
+uint16_t sensor_panel_current_x100(void);    /* panel current,       x100 A */
+uint16_t sensor_battery_current_x100(void);  /* battery current,     x100 A */
+uint16_t sensor_motor_current_x100(void);    /* motor current,       x100 A */
 
 #endif /* DRIVERS_SENSORS_H_ */
@@ -4,8 +4,8 @@
 
 int main(void)
 {
-    WDT_A_hold(WDT_A_BASE);   /* stop the watchdog before the long crystal
-                               * startup in clock_init() */
+    WDT_A_hold(WDT_A_BASE);   /* stop the watchdog before start-up; the
+                               * crystals then settle in the background */
 
     state_machine_run();      /* init + control loop; never returns */
 
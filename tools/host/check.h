@@ -0,0 +1,34 @@
+/*
+ * tools/host/check.h — minimal assertion helpers for the host checks.
+ *
+ * Each test_*.c is one program: CHECK() reports a failed condition with
+ * its line and carries on, check_result() prints the tally and gives the
+ * exit code, so `make` stops on the first failing program.
+ */
+
+#ifndef TOOLS_HOST_CHECK_H_
+#define TOOLS_HOST_CHECK_H_
+
+#include <stdio.h>
+
+static unsigned s_checks;
+static unsigned s_failures;
+
+#define CHECK(cond) \
+    do { \
+        s_checks++; \
+        if (!(cond)) \
+        { \
+            s_failures++; \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+/* Print "name: n checks, m failed" and return the process exit code. */
+static int check_result(const char *name)
+{
+    printf("%s: %u checks, %u failed\n", name, s_checks, s_failures);
+    return s_failures ? 1 : 0;
+}
+
+#endif /* TOOLS_HOST_CHECK_H_ */
@@ -0,0 +1,15 @@
+/*
+ * tools/host/host_crc_hw.c — stand-in for bsp/crc on the host.
+ *
+ * The CRC16 module only exists on the target. HMI_CRC_BACKEND selects it,
+ * so drivers/crc16 links against crc_hw_ccitt(); on the host it is the
+ * bitwise reference, which the target's module must match anyway.
+ */
+
+#include "bsp/crc.h"
+#include "drivers/crc16.h"
+
+uint16_t crc_hw_ccitt(uint16_t seed, const uint8_t *data, uint16_t len)
+{
+    return crc16_ccitt_bitwise(seed, data, len);
+}
@@ -0,0 +1,4 @@
+/*
+ * tools/host/include/driverlib/.../driverlib.h — empty stand-in for the
+ * TI driver library on the host, see tools/host/include/msp430.h.
+ */
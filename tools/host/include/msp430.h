@@ -0,0 +1,6 @@
+/*
+ * tools/host/include/msp430.h — empty stand-in for the device header.
+ *
+ * Lets firmware sources that include it but use none of its registers
+ * (drivers/sensors.c) build on the host.
+ */
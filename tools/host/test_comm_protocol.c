@@ -0,0 +1,179 @@
+/*
+ * tools/host/test_comm_protocol.c — report-by-exception heartbeat.
+ *
+ * Drives app/comm_protocol through its public API, the way the state
+ * machine and the RS485 master do: REG_CFG_HEARTBEAT_S is written with
+ * 0x06 frames, and comm_protocol_build_report() is called once per
+ * simulated measurement cycle with the telemetry left unchanged, so only
+ * the heartbeat can produce a report. The cached full report must never
+ * outlive the image it was built from. A 0x03 poll is offered to the
+ * fast path first and handed to comm_protocol_process() when declined,
+ * as the RS485 frame-gap ISR does; either way it is received once.
+ */
+
+#include <string.h>
+#include "config.h"
+#include "drivers/rs485.h"
+#include "app/comm_protocol.h"
+#include "check.h"
+
+/* A full report: header, bitmap, every read register, CRC. */
+#define FULL_REPORT_LEN     (2 + 2 + 2 * COMM_NUM_READ_REGS + 2)
+
+/* Write one register with a unicast 0x06; returns the response length. */
+static uint8_t write_single(uint16_t addr, uint16_t value)
+{
+    uint8_t data[4], req[RS485_MAX_FRAME], resp[RS485_MAX_FRAME];
+    uint8_t len;
+
+    data[0] = (uint8_t)(addr >> 8);
+    data[1] = (uint8_t)addr;
+    data[2] = (uint8_t)(value >> 8);
+    data[3] = (uint8_t)value;
+    len = rs485_build_frame(req, RS485_DEVICE_ADDRESS,
+                            MODBUS_FUNC_WRITE_SINGLE, data, sizeof data);
+    return comm_protocol_process(req, len, resp);
+}
+
+/* Offer a unicast 0x03 to the fast path, then to comm_protocol_process()
+ * if declined; returns the response length. */
+static uint8_t read_holding(uint16_t addr, uint16_t count)
+{
+    uint8_t data[4], req[RS485_MAX_FRAME], resp[RS485_MAX_FRAME];
+    uint8_t len, n;
+
+    data[0] = (uint8_t)(addr >> 8);
+    data[1] = (uint8_t)addr;
+    data[2] = (uint8_t)(count >> 8);
+    data[3] = (uint8_t)count;
+    len = rs485_build_frame(req, RS485_DEVICE_ADDRESS,
+                            MODBUS_FUNC_READ_HOLDING, data, sizeof data);
+    n = comm_protocol_fast_read(req, len, resp);
+    if (n == 0)
+        n = comm_protocol_process(req, len, resp);
+    return n;
+}
+
+/* Reports on an unchanged image: the first is full (after init or the
+ * last heartbeat), then the next full one must come exactly
+ * `expect_cycles` calls later, with nothing in between. */
+static void check_heartbeat(uint32_t expect_cycles)
+{
+    uint8_t  out[RS485_MAX_FRAME];
+    uint32_t n;
+    uint8_t  len;
+
+    len = comm_protocol_build_report(out);
+    CHECK(len == FULL_REPORT_LEN);
+
+    for (n = 1; n < expect_cycles; n++)
+    {
+        len = comm_protocol_build_report(out);
+        if (len != 0)
+            break;
+    }
+    CHECK(n == expect_cycles);
+
+    len = comm_protocol_build_report(out);
+    CHECK(len == FULL_REPORT_LEN);
+    CHECK(out[2] == 0x01 && out[3] == 0xFF);   /* all nine registers */
+}
+
+static uint32_t cycles_for(uint32_t heartbeat_s)
+{
+    return (heartbeat_s + MEASURE_INTERVAL_S - 1) / MEASURE_INTERVAL_S;
+}
+
+/* 65536 telemetry changes without a full report bring the telemetry
+ * generation back to the value the cached frame is tagged with; the next
+ * full report must still carry the current values. */
+static void check_report_cache(void)
+{
+    uint8_t     out[RS485_MAX_FRAME];
+    telemetry_t t;
+    uint32_t    k;
+
+    memset(&t, 0, sizeof t);
+    comm_protocol_init();
+    CHECK(write_single(REG_CFG_HEARTBEAT_S, MEASURE_INTERVAL_S) != 0);
+    comm_protocol_update_telemetry(&t);
+    CHECK(comm_protocol_build_report(out) == FULL_REPORT_LEN);
+
+    for (k = 1; k < 65536UL; k++)
+    {
+        t.flow = (uint16_t)k;
+        comm_protocol_update_telemetry(&t);
+    }
+    t.flow = 12345;
+    comm_protocol_update_telemetry(&t);
+
+    CHECK(comm_protocol_build_report(out) == FULL_REPORT_LEN);
+    CHECK(out[4] == (12345 >> 8) && out[5] == (12345 & 0xFF));
+
+    /* Unchanged image: the next full report is the same frame. */
+    {
+        uint8_t again[RS485_MAX_FRAME];
+        CHECK(comm_protocol_build_report(again) == FULL_REPORT_LEN);
+        CHECK(memcmp(out, again, FULL_REPORT_LEN) == 0);
+    }
+}
+
+/* Each poll counts once, answered on the fast path or declined by it. */
+static void check_rx_count(void)
+{
+    telemetry_t t;
+
+    memset(&t, 0, sizeof t);
+    comm_protocol_init();
+    comm_protocol_update_telemetry(&t);
+
+    CHECK(read_holding(REG_FLOW, COMM_NUM_READ_REGS) != 0);
+    CHECK(comm_protocol_rx_count() == 1);
+
+    CHECK(read_holding(REG_FLOW, 0) == 0);              /* bad range */
+    CHECK(comm_protocol_rx_count() == 2);
+
+    CHECK(read_holding(0x7FFF, 1) == 0);                /* no register */
+    CHECK(comm_protocol_rx_count() == 3);
+}
+
+int main(void)
+{
+    telemetry_t t;
+
+    memset(&t, 0, sizeof t);
+    t.batt_voltage = 1250;
+
+    /* Default heartbeat from config.h. */
+    comm_protocol_init();
+    comm_protocol_update_telemetry(&t);
+    check_heartbeat(cycles_for(REPORT_HEARTBEAT_S));
+
+    /* The top of the register range must not wrap to "every cycle". */
+    comm_protocol_init();
+    comm_protocol_update_telemetry(&t);
+    CHECK(write_single(REG_CFG_HEARTBEAT_S, 65535u) != 0);
+    check_heartbeat(cycles_for(65535u));
+
+    comm_protocol_init();
+    comm_protocol_update_telemetry(&t);
+    CHECK(write_single(REG_CFG_HEARTBEAT_S, 65534u) != 0);
+    check_heartbeat(cycles_for(65534u));
+
+    /* Shortest accepted value: one measurement cycle. */
+    comm_protocol_init();
+    comm_protocol_update_telemetry(&t);
+    CHECK(write_single(REG_CFG_HEARTBEAT_S, MEASURE_INTERVAL_S) != 0);
+    check_heartbeat(1);
+
+    /* Shorter than a cycle is rejected and changes nothing. */
+    comm_protocol_init();
+    comm_protocol_update_telemetry(&t);
+    CHECK(write_single(REG_CFG_HEARTBEAT_S, MEASURE_INTERVAL_S - 1) == 0);
+    check_heartbeat(cycles_for(REPORT_HEARTBEAT_S));
+
+    check_report_cache();
+    check_rx_count();
+
+    return check_result("test_comm_protocol");
+}
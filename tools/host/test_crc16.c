@@ -0,0 +1,96 @@
+/*
+ * tools/host/test_crc16.c — CRC16 backend equivalence.
+ *
+ * Every software backend of drivers/crc16 must give the bitwise
+ * reference result, bit for bit: on the standard check vectors, on random
+ * buffers with random seeds, and when a buffer is checksummed in pieces
+ * (as drivers/rs485 does while it builds a frame). The HW backend exists
+ * only on the target; crc16_bench() checks it there.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "drivers/crc16.h"
+#include "check.h"
+
+#define RANDOM_RUNS     2000
+#define MAX_LEN         300
+
+static const uint8_t s_check[] = "123456789";
+
+/* Reference vectors from the Modbus serial-line spec: a read holding
+ * registers request and its CRC, low byte first on the wire. */
+static const uint8_t s_modbus_req[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A };
+#define MODBUS_REQ_CRC  0xCDC5u
+
+static void check_vectors(void)
+{
+    uint16_t n = (uint16_t)(sizeof s_check - 1);
+
+    CHECK(crc16_modbus_bitwise(0xFFFF, s_check, n) == 0x4B37);
+    CHECK(crc16_modbus_nibble(0xFFFF, s_check, n)  == 0x4B37);
+    CHECK(crc16_modbus_table(0xFFFF, s_check, n)   == 0x4B37);
+    CHECK(crc16_modbus(0xFFFF, s_check, n)         == 0x4B37);
+
+    CHECK(crc16_modbus_bitwise(0xFFFF, s_modbus_req, sizeof s_modbus_req)
+          == MODBUS_REQ_CRC);
+    CHECK(crc16_modbus_nibble(0xFFFF, s_modbus_req, sizeof s_modbus_req)
+          == MODBUS_REQ_CRC);
+    CHECK(crc16_modbus_table(0xFFFF, s_modbus_req, sizeof s_modbus_req)
+          == MODBUS_REQ_CRC);
+
+    /* CRC-16/XMODEM (CCITT, init 0). */
+    CHECK(crc16_ccitt_bitwise(0x0000, s_check, n) == 0x31C3);
+    CHECK(crc16_ccitt_nibble(0x0000, s_check, n)  == 0x31C3);
+    CHECK(crc16_ccitt_table(0x0000, s_check, n)   == 0x31C3);
+
+    /* Empty input leaves the seed. */
+    CHECK(crc16_modbus_table(0x1234, s_check, 0) == 0x1234);
+    CHECK(crc16_ccitt_nibble(0x1234, s_check, 0) == 0x1234);
+}
+
+static void check_random(void)
+{
+    static uint8_t buf[MAX_LEN];
+    unsigned run;
+
+    srand(12345);
+    for (run = 0; run < RANDOM_RUNS; run++)
+    {
+        uint16_t len  = (uint16_t)(rand() % (MAX_LEN + 1));
+        uint16_t seed = (uint16_t)rand();
+        uint16_t cut  = len ? (uint16_t)(rand() % (len + 1)) : 0;
+        uint16_t ref, crc, i;
+
+        for (i = 0; i < len; i++)
+            buf[i] = (uint8_t)rand();
+
+        ref = crc16_modbus_bitwise(seed, buf, len);
+        CHECK(crc16_modbus_nibble(seed, buf, len) == ref);
+        CHECK(crc16_modbus_table(seed, buf, len)  == ref);
+        CHECK(crc16_modbus(seed, buf, len)        == ref);
+
+        /* In two pieces, and byte by byte. */
+        crc = crc16_modbus(seed, buf, cut);
+        CHECK(crc16_modbus(crc, buf + cut, (uint16_t)(len - cut)) == ref);
+        crc = seed;
+        for (i = 0; i < len; i++)
+            crc = crc16_modbus_byte(crc, buf[i]);
+        CHECK(crc == ref);
+
+        ref = crc16_ccitt_bitwise(seed, buf, len);
+        CHECK(crc16_ccitt_nibble(seed, buf, len) == ref);
+        CHECK(crc16_ccitt_table(seed, buf, len)  == ref);
+        crc = crc16_ccitt_table(seed, buf, cut);
+        CHECK(crc16_ccitt_nibble(crc, buf + cut, (uint16_t)(len - cut))
+              == ref);
+    }
+}
+
+int main(void)
+{
+    check_vectors();
+    check_random();
+    return check_result("test_crc16");
+}
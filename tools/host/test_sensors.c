@@ -0,0 +1,107 @@
+/*
+ * tools/host/test_sensors.c — fixed-point sensor scaling.
+ *
+ * drivers/sensors folds the float SENSOR_* constants of config.h into Q16
+ * gains and offsets. Every code on every channel must read within 1 LSB
+ * (0.01 V / 0.01 A) of the float formulas it replaced, so a config.h
+ * change that breaks the folding (an overflowing gain, a lost offset)
+ * fails here:
+ *   - all 4096 raw 12-bit codes through sensor_raw_to_x100(), against
+ *     the old float path (clamp at 0, x100, truncate, clamp at 65535);
+ *   - all 65536 oversampled codes through sensor_code16_to_x100();
+ *   - sensor_x100_to_raw() as the exact inverse on the 12-bit scale.
+ */
+
+#include "config.h"
+#include "drivers/sensors.h"
+#include "check.h"
+
+/* The float conversion of the old drivers/sensors.c, pin volts in. */
+static float formula(sensor_id_t id, float vadc)
+{
+    switch (id)
+    {
+        case SENSOR_PANEL_V:
+            return vadc * ((SENSOR_PANEL_V_RTOP + SENSOR_PANEL_V_RBOT)
+                           / SENSOR_PANEL_V_RBOT);
+        case SENSOR_BATT_V:
+            return vadc * ((SENSOR_BATT_V_RTOP + SENSOR_BATT_V_RBOT)
+                           / SENSOR_BATT_V_RBOT);
+        case SENSOR_PANEL_I:
+            return (vadc / SENSOR_PANEL_I_RIMON - SENSOR_PANEL_I_IBIAS)
+                   * (1000.0f / SENSOR_PANEL_I_RSENSE);
+        case SENSOR_BATT_I:
+            return vadc / SENSOR_BATT_I_DIV;
+        case SENSOR_MOTOR_I:
+        default:
+            return vadc / (SENSOR_MOTOR_I_RSHUNT * SENSOR_MOTOR_I_GAIN);
+    }
+}
+
+/* The old state machine's scale_x100(). */
+static uint16_t float_x100(sensor_id_t id, float raw)
+{
+    float v = formula(id, raw * ADC_VREF_VOLTS / ADC_FULL_SCALE);
+    float s;
+
+    if (v < 0.0f)
+        v = 0.0f;
+    s = v * 100.0f;
+    if (s > 65535.0f)
+        s = 65535.0f;
+    return (uint16_t)s;
+}
+
+static int within_1lsb(uint16_t a, uint16_t b)
+{
+    return (a > b) ? (a - b) <= 1 : (b - a) <= 1;
+}
+
+static void check_channel(sensor_id_t id)
+{
+    uint32_t code;
+    unsigned bad12 = 0, bad16 = 0, badinv = 0;
+
+    for (code = 0; code < 4096; code++)
+    {
+        if (!within_1lsb(sensor_raw_to_x100(id, (uint16_t)code),
+                         float_x100(id, (float)code)))
+            bad12++;
+    }
+    CHECK(bad12 == 0);
+
+    for (code = 0; code < 65536; code++)
+    {
+        if (!within_1lsb(sensor_code16_to_x100(id, (uint16_t)code),
+                         float_x100(id, (float)code / 16.0f)))
+            bad16++;
+    }
+    CHECK(bad16 == 0);
+
+    /* Monotonic, and the inverse is the last code at or below x100. */
+    for (code = 1; code < 4096; code++)
+    {
+        if (sensor_raw_to_x100(id, (uint16_t)code) <
+            sensor_raw_to_x100(id, (uint16_t)(code - 1)))
+            badinv++;
+    }
+    for (code = 0; code < 4096; code += 7)
+    {
+        uint16_t x100 = sensor_raw_to_x100(id, (uint16_t)code);
+        uint16_t raw  = sensor_x100_to_raw(id, x100);
+
+        if (sensor_raw_to_x100(id, raw) > x100 ||
+            (raw < 4095 && sensor_raw_to_x100(id, (uint16_t)(raw + 1)) <= x100))
+            badinv++;
+    }
+    CHECK(badinv == 0);
+}
+
+int main(void)
+{
+    sensor_id_t id;
+
+    for (id = SENSOR_PANEL_V; id < SENSOR_COUNT; id++)
+        check_channel(id);
+    return check_result("test_sensors");
+}